@@ -0,0 +1,194 @@
+#include "fd_adapter.hh"
+#include "lossy_fd_adapter.hh"
+#include "tcp_connection.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+
+using namespace std;
+
+// Runs a bulk transfer between two TCPConnections over a simulated bottleneck (a drop-tail
+// queue draining at a fixed rate, followed by a propagation delay), with random loss on the
+// data path added by a LossyFdAdapter, and reports the goodput and the number of
+// retransmitted segments for each congestion control algorithm, with and without pacing.
+
+constexpr size_t rate = 1250;                     // bytes per ms, i.e. 10 Mbit/s
+constexpr size_t one_way_delay = 10;              // ms, so the bandwidth-delay product is 25 kB
+constexpr size_t queue_limits[] = {15000, 4000};  // bytes the bottleneck can queue: moderate, then shallow
+constexpr size_t header_size = 40;                // bytes of IP and TCP header that each segment adds on the wire
+constexpr size_t duration = 20 * 1000;            // simulated ms
+
+//! An in-memory link with an FdAdapter's read/write interface
+class BottleneckLink : public FdAdapterBase {
+  private:
+    size_t _rate;
+    size_t _delay;
+    size_t _queue_limit;
+
+    size_t _now{0};
+    size_t _budget{0};        //!< bytes the link may still serialize this ms
+    size_t _queued_bytes{0};  //!< bytes waiting in the queue
+    deque<TCPSegment> _queue{};
+    deque<pair<size_t, TCPSegment>> _in_flight{};  //!< segments on the wire, with their arrival times
+
+    static size_t wire_size(const TCPSegment &seg) { return seg.payload().size() + header_size; }
+
+  public:
+    BottleneckLink(const size_t rate_, const size_t delay, const size_t queue_limit_)
+        : _rate(rate_), _delay(delay), _queue_limit(queue_limit_) {}
+
+    //! Queue a segment, or drop it if the queue is full
+    void write(TCPSegment &seg) {
+        if (_queued_bytes + wire_size(seg) > _queue_limit) {
+            return;
+        }
+        _queued_bytes += wire_size(seg);
+        _queue.push_back(seg);
+    }
+
+    //! \returns the next segment to have arrived at the far end, if any
+    optional<TCPSegment> read() {
+        if (_in_flight.empty() or _in_flight.front().first > _now) {
+            return {};
+        }
+        TCPSegment seg = move(_in_flight.front().second);
+        _in_flight.pop_front();
+        return seg;
+    }
+
+    void tick(const size_t ms_since_last_tick) {
+        _now += ms_since_last_tick;
+        _budget += _rate * ms_since_last_tick;
+        while (not _queue.empty() and _budget >= wire_size(_queue.front())) {
+            _budget -= wire_size(_queue.front());
+            _queued_bytes -= wire_size(_queue.front());
+            _in_flight.emplace_back(_now + _delay, move(_queue.front()));
+            _queue.pop_front();
+        }
+        // an idle link can't save up capacity
+        if (_queue.empty()) {
+            _budget = min(_budget, _rate);
+        }
+    }
+};
+
+struct Result {
+    double goodput;  // Mbit/s
+    size_t retransmissions;
+    size_t segments;
+};
+
+static Result run(const TCPConfig::CongestionControl algorithm,
+                  const bool pacing,
+                  const size_t queue_limit,
+                  const uint16_t loss_rate) {
+    TCPConfig config;
+    config.adaptive_rto = true;
+    config.congestion_control = algorithm;
+    config.pacing = pacing;
+    config.fixed_isn = WrappingInt32{0};
+    TCPConnection x{config}, y{config};
+
+    LossyFdAdapter<BottleneckLink> data_path{BottleneckLink{rate, one_way_delay, queue_limit}};
+    LossyFdAdapter<BottleneckLink> ack_path{BottleneckLink{100 * rate, one_way_delay, 100 * queue_limits[0]}};
+    data_path.config_mut().loss_rate_up = loss_rate;
+
+    const string chunk(TCPConfig::DEFAULT_CAPACITY, 'x');
+    x.connect();
+
+    bool closing = false;
+    uint64_t highest_sent = 0;  // absolute seqno just past the furthest byte x has sent
+    Result result{};
+
+    auto step = [&] {
+        if (not closing) {
+            x.write(chunk.substr(0, x.remaining_outbound_capacity()));
+        }
+
+        while (not x.segments_out().empty()) {
+            TCPSegment &seg = x.segments_out().front();
+            const uint64_t end = unwrap(seg.header().seqno, WrappingInt32{0}, highest_sent) +
+                                 seg.length_in_sequence_space();
+            if (seg.length_in_sequence_space() > 0) {
+                result.segments++;
+                if (end <= highest_sent) {
+                    result.retransmissions++;
+                }
+            }
+            highest_sent = max(highest_sent, end);
+            data_path.write(seg);
+            x.segments_out().pop();
+        }
+        while (not y.segments_out().empty()) {
+            ack_path.write(y.segments_out().front());
+            y.segments_out().pop();
+        }
+
+        data_path.tick(1);
+        ack_path.tick(1);
+        while (auto seg = data_path.read()) {
+            y.segment_received(move(seg.value()));
+        }
+        while (auto seg = ack_path.read()) {
+            x.segment_received(move(seg.value()));
+        }
+        y.inbound_stream().pop_output(y.inbound_stream().buffer_size());
+
+        x.tick(1);
+        y.tick(1);
+    };
+
+    for (size_t now = 0; now < duration; now++) {
+        step();
+    }
+    const size_t bytes_received = y.inbound_stream().bytes_read();
+
+    // wind the connection down cleanly (a lossy close can take a while, but simulated time is cheap)
+    closing = true;
+    x.end_input_stream();
+    y.end_input_stream();
+    for (size_t now = 0; now < 100 * duration and (x.active() or y.active()); now++) {
+        step();
+    }
+
+    result.goodput = double(bytes_received) * 8 / 1000 / duration;
+    return result;
+}
+
+int main() {
+    try {
+        const tuple<TCPConfig::CongestionControl, bool, string> algorithms[] = {
+            {TCPConfig::CongestionControl::None, false, "none"},
+            {TCPConfig::CongestionControl::NewReno, false, "NewReno"},
+            {TCPConfig::CongestionControl::Cubic, false, "CUBIC"},
+            {TCPConfig::CongestionControl::NewReno, true, "NewReno, paced"},
+            {TCPConfig::CongestionControl::Cubic, true, "CUBIC, paced"}};
+
+        cout << fixed << setprecision(2);
+        for (const size_t queue_limit : queue_limits) {
+            cout << "10 Mbit/s bottleneck, " << 2 * one_way_delay << " ms RTT, " << queue_limit / 1000
+                 << " kB queue, " << duration / 1000 << " s transfer\n\n";
+            for (const double loss : {0.0, 0.001, 0.01, 0.03}) {
+                for (const auto &[algorithm, pacing, name] : algorithms) {
+                    const auto result = run(algorithm, pacing, queue_limit, static_cast<uint16_t>(loss * 65536));
+                    cout << setw(5) << loss * 100 << "% loss  " << left << setw(15) << name << right << setw(7)
+                         << result.goodput << " Mbit/s goodput " << setw(6) << result.retransmissions << " of "
+                         << setw(6) << result.segments << " segments retransmitted\n";
+                }
+            }
+            cout << "\n";
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
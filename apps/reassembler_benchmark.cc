@@ -0,0 +1,260 @@
+#include "stream_reassembler.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Drives a StreamReassembler with one arrival pattern at a time and reports the time per
+// byte, heap allocations per push_substring() and how far the pushes raise the peak RSS.
+// Each run makes its own pattern and data in its own child process, so that neither an
+// earlier run's peak nor another pattern's memory is counted. Payloads are slices of one
+// shared Buffer (as parsed segments are), so the only allocations counted are the
+// reassembler's and its output stream's.
+
+static size_t allocations = 0;
+
+void *operator new(const size_t size) {
+    ++allocations;
+    if (void *ptr = malloc(size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+constexpr size_t segment_size = 1000;
+constexpr size_t window = 64 * 1024;
+
+//! A substring to push: (stream index, length)
+using Push = pair<uint64_t, size_t>;
+
+struct Pattern {
+    string name;
+    size_t len;
+    size_t capacity;
+    vector<Push> pushes;
+};
+
+//! Split [begin, end) into pieces of at most `size` bytes
+static vector<Push> split(const uint64_t begin, const uint64_t end, const size_t size) {
+    vector<Push> ret;
+    for (uint64_t i = begin; i < end; i += size) {
+        ret.emplace_back(i, min<uint64_t>(size, end - i));
+    }
+    return ret;
+}
+
+//! Cut the stream into windows of pieces, and let `arrange` reorder (or add to) each window's pushes
+template <typename T>
+static vector<Push> per_window(const size_t len, const size_t piece, T &&arrange) {
+    vector<Push> ret;
+    for (uint64_t start = 0; start < len; start += window) {
+        const uint64_t end = min<uint64_t>(start + window, len);
+        auto pushes = split(start, end, piece);
+        arrange(pushes, end);
+        ret.insert(ret.end(), pushes.begin(), pushes.end());
+    }
+    return ret;
+}
+
+//! \returns functions that each make one pattern, so that a child process can make just its own
+static vector<function<Pattern()>> pattern_makers() {
+    constexpr size_t len = 64 * 1024 * 1024;
+    constexpr size_t num_holes = 10000;
+    vector<function<Pattern()>> ret;
+
+    ret.emplace_back([] { return Pattern{"in order", len, window, split(0, len, segment_size)}; });
+
+    ret.emplace_back([] {
+        return Pattern{"reversed windows", len, window, per_window(len, segment_size, [](auto &pushes, auto) {
+                           reverse(pushes.begin(), pushes.end());
+                       })};
+    });
+
+    ret.emplace_back([] {
+        auto rd = get_random_generator();
+        return Pattern{"random permutation", len, window, per_window(len, segment_size, [&](auto &pushes, auto) {
+                           shuffle(pushes.begin(), pushes.end(), rd);
+                       })};
+    });
+
+    // every segment arrives four times, shuffled within its window
+    ret.emplace_back([] {
+        auto rd = get_random_generator();
+        return Pattern{"4x duplication", len / 4, window, per_window(len / 4, segment_size, [&](auto &pushes, auto) {
+                           const auto once = pushes;
+                           for (int i = 0; i < 3; ++i) {
+                               pushes.insert(pushes.end(), once.begin(), once.end());
+                           }
+                           shuffle(pushes.begin(), pushes.end(), rd);
+                       })};
+    });
+
+    ret.emplace_back([] {
+        auto rd = get_random_generator();
+        return Pattern{"1-byte fragments", len / 64, window, per_window(len / 64, 1, [&](auto &pushes, auto) {
+                           shuffle(pushes.begin(), pushes.end(), rd);
+                       })};
+    });
+
+    // back-to-front 4-segment retransmits starting every segment, so most bytes arrive four times
+    ret.emplace_back([] {
+        const auto retransmits = [](auto &pushes, auto end) {
+            for (auto &[index, size] : pushes) {
+                size = min<uint64_t>(4 * segment_size, end - index);
+            }
+            reverse(pushes.begin(), pushes.end());
+        };
+        return Pattern{
+            "large overlapping retransmits", len / 4, window, per_window(len / 4, segment_size, retransmits)};
+    });
+
+    // each window fills up except for its first byte, which arrives last
+    ret.emplace_back([] {
+        const auto saturate = [](auto &pushes, auto) {
+            const auto [index, size] = pushes.front();
+            pushes.front() = {index + 1, size - 1};
+            pushes.emplace_back(index, 1);
+        };
+        return Pattern{"capacity-saturating holes", len, window, per_window(len, segment_size, saturate)};
+    });
+
+    // every other segment arrives first; the holes are then filled front-to-back
+    // (each fill releases two segments) or back-to-front (nothing is released until the end)
+    for (const bool fill_backwards : {false, true}) {
+        ret.emplace_back([fill_backwards] {
+            constexpr size_t holes_len = 2 * num_holes * segment_size;
+            const auto segments = split(0, holes_len, segment_size);
+            vector<Push> pushes, holes;
+            for (size_t i = 0; i < segments.size(); ++i) {
+                (i % 2 ? pushes : holes).push_back(segments[i]);
+            }
+            if (fill_backwards) {
+                reverse(holes.begin(), holes.end());
+            }
+            pushes.insert(pushes.end(), holes.begin(), holes.end());
+            return Pattern{fill_backwards ? "10k holes, filled back to front" : "10k holes, filled front to back",
+                           holes_len,
+                           holes_len,
+                           move(pushes)};
+        });
+    }
+
+    return ret;
+}
+
+struct Config {
+    string name;
+    StreamReassembler::Storage storage;
+    ByteStream::Storage output_storage;
+};
+
+//! \returns the process's resident set size now, in KiB
+static long current_rss_kib() {
+    long pages = 0, resident = 0;
+    ifstream statm{"/proc/self/statm"};
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void run(const Pattern &pattern, const Config &config) {
+    string data_str(pattern.len, 'x');
+    for (auto &ch : data_str) {
+        ch = rand();
+    }
+    const Buffer data{move(data_str)};
+
+    vector<Buffer> payloads;
+    payloads.reserve(pattern.pushes.size());
+    for (const auto &[index, size] : pattern.pushes) {
+        Buffer payload = data;
+        payload.remove_suffix(data.size() - index - size);
+        payload.remove_prefix(index);
+        payloads.push_back(move(payload));
+    }
+
+    StreamReassembler reassembler{pattern.capacity, config.storage, config.output_storage};
+    ByteStream &out = reassembler.stream_out();
+
+    // the pattern and its data are the harness's; only what the pushes add is the reassembler's
+    const long rss_before_kib = current_rss_kib();
+    const size_t allocations_before = allocations;
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        const uint64_t index = pattern.pushes[i].first;
+        reassembler.push_substring(payloads[i], index, index + payloads[i].size() == pattern.len);
+        out.pop_output(out.buffer_size());
+    }
+    const auto final_time = high_resolution_clock::now();
+    const size_t allocations_during = allocations - allocations_before;
+
+    if (out.bytes_written() != pattern.len or not out.eof()) {
+        throw runtime_error(pattern.name + ": reassembled " + to_string(out.bytes_written()) + " of " +
+                            to_string(pattern.len) + " bytes");
+    }
+
+    rusage usage{};
+    SystemCall("getrusage", getrusage(RUSAGE_SELF, &usage));
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    cout << fixed << setprecision(2);
+    cout << left << setw(32) << pattern.name << setw(6) << config.name << right << setw(9)
+         << double(duration) / pattern.len << " ns/byte" << setw(9)
+         << double(allocations_during) / pattern.pushes.size() << " allocs/push" << setw(8)
+         << max(0L, usage.ru_maxrss - rss_before_kib) << " KiB peak RSS growth\n";
+}
+
+int main() {
+    try {
+        const auto makers = pattern_makers();
+        const vector<Config> configs = {{"map", StreamReassembler::Storage::Map, ByteStream::Storage::Ring},
+                                        {"map+c", StreamReassembler::Storage::Map, ByteStream::Storage::Chunked},
+                                        {"ring", StreamReassembler::Storage::Ring, ByteStream::Storage::Ring}};
+
+        cout << "map = Storage::Map, map+c = Storage::Map with a chunked output stream (as in TCPReceiver),"
+             << " ring = Storage::Ring\n\n";
+        for (size_t i = 0; i < makers.size(); ++i) {
+            for (const auto &config : configs) {
+                cout.flush();
+                const pid_t child = SystemCall("fork", fork());
+                if (child == 0) {
+                    try {
+                        run(makers[i](), config);
+                    } catch (const exception &e) {
+                        cerr << e.what() << "\n";
+                        _exit(EXIT_FAILURE);
+                    }
+                    cout.flush();
+                    _exit(EXIT_SUCCESS);
+                }
+                int status = 0;
+                SystemCall("waitpid", waitpid(child, &status, 0));
+                if (not WIFEXITED(status) or WEXITSTATUS(status) != EXIT_SUCCESS) {
+                    throw runtime_error("pattern " + to_string(i) + " (" + config.name + ") failed");
+                }
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
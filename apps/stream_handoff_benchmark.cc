@@ -0,0 +1,102 @@
+#include "concurrent_byte_stream.hh"
+#include "socket.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// Compares the two ways of handing a byte stream between the owner thread and the
+// TCP thread: the AF_UNIX socketpair that TCPSpongeSocket uses today, and a shared
+// ConcurrentByteStream ring (blocking on eventfds only when a side runs dry).
+
+constexpr size_t len = 256 * 1024 * 1024;
+constexpr size_t chunk_size = 65536;
+constexpr size_t ring_capacity = 1048576;
+
+void report(const string &name, const high_resolution_clock::time_point start, const size_t bytes_received) {
+    const auto duration = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+    if (bytes_received != len) {
+        throw runtime_error(name + ": received " + to_string(bytes_received) + " bytes, expected " + to_string(len));
+    }
+    cout << fixed << setprecision(2);
+    cout << "Thread handoff throughput via " << name << ": " << len * 8.0 / double(duration) << " Gbit/s\n";
+}
+
+void socketpair_loop(const string &chunk) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    LocalStreamSocket writer_end{FileDescriptor(fds[0])}, reader_end{FileDescriptor(fds[1])};
+
+    const auto start = high_resolution_clock::now();
+
+    thread writer([&] {
+        for (size_t sent = 0; sent < len; sent += chunk.size()) {
+            writer_end.write(chunk);
+        }
+        writer_end.shutdown(SHUT_WR);
+    });
+
+    size_t bytes_received = 0;
+    string buffer;
+    while (not reader_end.eof()) {
+        reader_end.read(buffer, chunk_size);
+        bytes_received += buffer.size();
+    }
+    writer.join();
+
+    report("socketpair          ", start, bytes_received);
+}
+
+void ring_loop(const string &chunk) {
+    ConcurrentByteStream stream{ring_capacity, true};
+
+    const auto start = high_resolution_clock::now();
+
+    thread writer([&] {
+        for (size_t sent = 0; sent < len;) {
+            const size_t written = stream.write(string_view(chunk).substr(sent % chunk.size()));
+            if (written == 0) {
+                stream.wait_writable();
+            }
+            sent += written;
+        }
+        stream.end_input();
+    });
+
+    size_t bytes_received = 0;
+    while (not stream.eof()) {
+        const auto data = stream.read(chunk_size);
+        if (data.empty()) {
+            stream.wait_readable();
+        }
+        bytes_received += data.size();
+    }
+    writer.join();
+
+    report("ConcurrentByteStream", start, bytes_received);
+}
+
+int main() {
+    try {
+        string chunk(chunk_size, 'x');
+        for (auto &ch : chunk) {
+            ch = rand();
+        }
+
+        socketpair_loop(chunk);
+        ring_loop(chunk);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,22 +1,61 @@
 #include "tcp_connection.hh"
+#include "util.hh"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <new>
+#include <random>
 #include <string>
 
 using namespace std;
 using namespace std::chrono;
 
-constexpr size_t len = 100 * 1024 * 1024;
+// count heap allocations, to report how many each segment costs
+static size_t allocations = 0;
+
+void *operator new(const size_t size) {
+    ++allocations;
+    if (void *ptr = malloc(size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
 
-void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+constexpr size_t len = 100 * 1024 * 1024;
+constexpr size_t rtt = 10;  // simulated ms per exchange of segments, well under the 1 s retransmission timeout
+
+//! \returns the number of segments moved (including any dropped)
+size_t move_segments(TCPConnection &x,
+                     TCPConnection &y,
+                     vector<TCPSegment> &segments,
+                     const bool reorder,
+                     const uint16_t loss_rate = 0,
+                     const bool gro = false) {
+    static mt19937 rd{get_random_generator()};
+    size_t dropped = 0;
     while (not x.segments_out().empty()) {
-        segments.emplace_back(move(x.segments_out().front()));
+        // drop as LossyFdAdapter does
+        if (loss_rate != 0 and uint16_t(rd()) < loss_rate) {
+            dropped++;
+        } else {
+            segments.emplace_back(move(x.segments_out().front()));
+        }
         x.segments_out().pop();
     }
-    if (reorder) {
+    if (gro) {
+        // hand y all of them at once, as a receive-heavy host draining its adapter would
+        if (reorder) {
+            reverse(segments.begin(), segments.end());
+        }
+        y.segments_received(segments);
+    } else if (reorder) {
         for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
             y.segment_received(move(*it));
         }
@@ -25,11 +64,19 @@ void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segme
             y.segment_received(move(*it));
         }
     }
+    const size_t moved = segments.size() + dropped;
     segments.clear();
+    return moved;
 }
 
-void main_loop(const bool reorder) {
+void main_loop(const bool reorder,
+               const double loss = 0,
+               const uint16_t ack_delay = 0,
+               const bool gro = false,
+               const size_t recv_capacity_max = 0) {
     TCPConfig config;
+    config.ack_delay = ack_delay;
+    config.recv_capacity_max = recv_capacity_max;
     TCPConnection x{config}, y{config};
 
     string string_to_send(len, 'x');
@@ -46,6 +93,11 @@ void main_loop(const bool reorder) {
     string string_received;
     string_received.reserve(len);
 
+    size_t segments_sent = 0;
+    size_t acks_sent = 0;
+    size_t round_trips = 0;
+    size_t peak_committed = 0;
+    const size_t allocations_before = allocations;
     const auto first_time = high_resolution_clock::now();
 
     auto loop = [&] {
@@ -66,8 +118,10 @@ void main_loop(const bool reorder) {
 
         // exchange segments between x and y but in reverse order
         vector<TCPSegment> segments;
-        move_segments(x, y, segments, reorder);
-        move_segments(y, x, segments, false);
+        segments_sent += move_segments(x, y, segments, reorder, static_cast<uint16_t>(loss * 65536), gro);
+        acks_sent += move_segments(y, x, segments, false);
+
+        peak_committed = max(peak_committed, y.committed_receive_bytes());
 
         // read output from y
         const auto available_output = y.inbound_stream().buffer_size();
@@ -76,27 +130,48 @@ void main_loop(const bool reorder) {
         }
 
         // time passes
-        x.tick(1000);
-        y.tick(1000);
+        x.tick(rtt);
+        y.tick(rtt);
+        round_trips++;
     };
 
     while (not y.inbound_stream().eof()) {
         loop();
     }
+    const size_t transfer_round_trips = round_trips;
+    const size_t transfer_packets = segments_sent + acks_sent;
 
     if (string_received != string_to_send) {
         throw runtime_error("strings sent vs. received don't match");
     }
 
     const auto final_time = high_resolution_clock::now();
+    const size_t allocations_during = allocations - allocations_before;
 
     const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
 
     const auto gigabits_per_second = len * 8.0 / double(duration);
 
     cout << fixed << setprecision(2);
-    cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+    string conditions = reorder ? " with reordering" : "";
+    if (loss > 0) {
+        conditions += (reorder ? " and " : " with ") + to_string(lround(loss * 100)) + "% loss";
+    }
+    if (ack_delay > 0) {
+        conditions += (conditions.empty() ? " with " : " and ") + string("delayed ACKs");
+    }
+    if (gro) {
+        conditions += (conditions.empty() ? " with " : " and ") + string("GRO");
+    }
+    if (recv_capacity_max > 0) {
+        conditions += (conditions.empty() ? " with " : " and ") + string("window auto-tuning");
+    }
+    cout << "CPU-limited throughput" << left << setw(38) << conditions + ": " << right << gigabits_per_second
+         << " Gbit/s, " << double(allocations_during) / segments_sent << " allocations/segment, "
+         << transfer_round_trips << " round trips, " << setprecision(0) << transfer_packets * 1e6 / len
+         << " packets/MB (both ways), " << peak_committed / 1024 << " KiB peak receive memory, "
+         << 100 * (x.fast_path_hits() + y.fast_path_hits()) / (x.segments_processed() + y.segments_processed())
+         << "% fast path\n";
 
     while (x.active() or y.active()) {
         loop();
@@ -107,6 +182,14 @@ int main() {
     try {
         main_loop(false);
         main_loop(true);
+        main_loop(true, 0.01);
+        main_loop(false, 0.01);
+        main_loop(false, 0, TCPConfig::ACK_DELAY_DFLT);
+        main_loop(false, 0.01, TCPConfig::ACK_DELAY_DFLT);
+        main_loop(false, 0, 0, true);
+        main_loop(false, 0.01, 0, true);
+        main_loop(false, 0, 0, false, 16 * TCPConfig::DEFAULT_CAPACITY);
+        main_loop(false, 0.01, 0, false, 16 * TCPConfig::DEFAULT_CAPACITY);
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
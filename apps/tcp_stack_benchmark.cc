@@ -0,0 +1,177 @@
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_stack.hh"
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// How the CPU a TCPStack spends grows with its number of connections: to open them and move some
+// data over each, and then to keep time while they sit idle. For contrast, the idle cost of ticking
+// each connection every millisecond, as a TCPSpongeSocket per connection does.
+
+constexpr size_t bytes_per_connection = 4096;
+constexpr uint64_t idle_ms = 10000;
+constexpr uint16_t server_port = 80;
+
+//! \returns CPU seconds since `start`
+double cpu_seconds_since(const clock_t start) { return double(clock() - start) / CLOCKS_PER_SEC; }
+
+//! Carry the datagrams `from` has queued to `to`, serialized and parsed as a TUN device would, and
+//! handed over together, as an owner draining the device on one wakeup would
+//! \returns the number of datagrams carried
+size_t deliver(TCPStack &from, TCPStack &to) {
+    vector<InternetDatagram> dgrams;
+    for (auto &out = from.datagrams_out(); not out.empty(); out.pop()) {
+        if (dgrams.emplace_back().parse(out.front().serialize().concatenate()) != ParseResult::NoError) {
+            throw runtime_error("a datagram didn't parse");
+        }
+    }
+    to.datagrams_received(dgrams);
+    return dgrams.size();
+}
+
+//! Move the segments `x` has queued to `y`
+void move_segments(TCPConnection &x, TCPConnection &y) {
+    for (; not x.segments_out().empty(); x.segments_out().pop()) {
+        y.segment_received(x.segments_out().front());
+    }
+}
+
+//! \returns CPU seconds spent ticking `connections` pairs of idle connections, each by itself, every
+//! millisecond for `idle_ms`
+double tick_each(const size_t connections) {
+    TCPConfig config;
+    vector<TCPConnection> xs, ys;
+    xs.reserve(connections);
+    ys.reserve(connections);
+    for (size_t i = 0; i < connections; i++) {
+        TCPConnection &x = xs.emplace_back(config), &y = ys.emplace_back(config);
+        x.connect();
+        move_segments(x, y);
+        move_segments(y, x);
+        move_segments(x, y);
+    }
+
+    const clock_t start = clock();
+    for (uint64_t ms = 0; ms < idle_ms; ms++) {
+        for (size_t i = 0; i < connections; i++) {
+            xs[i].tick(1);
+            ys[i].tick(1);
+        }
+    }
+    const double ret = cpu_seconds_since(start);
+
+    for (size_t i = 0; i < connections; i++) {
+        xs[i].end_input_stream();
+        ys[i].end_input_stream();
+        while (xs[i].active() or ys[i].active()) {
+            move_segments(xs[i], ys[i]);
+            move_segments(ys[i], xs[i]);
+            xs[i].tick(100);
+            ys[i].tick(100);
+        }
+    }
+    return ret;
+}
+
+void main_loop(const size_t connections) {
+    const Address server_address{"10.0.0.1", server_port};
+    TCPConfig config;
+    TCPStack server, client;
+    server.listen(server_port, config, connections);  // every SYN arrives before the first accept()
+    const string data(bytes_per_connection, 'x');
+
+    // open the connections, have the client send each some data, and the server echo it back
+    const clock_t transfer_start = clock();
+    vector<TCPStack::FourTuple> tuples, accepted;
+    for (size_t i = 0; i < connections; i++) {
+        tuples.push_back(client.connect(config, {"10.0.0.2", uint16_t(1024 + i)}, server_address));
+        client.write(tuples.back(), data);
+    }
+    size_t datagrams = 0;
+    size_t echoed = 0;
+    size_t received = 0;
+    while (received < connections * bytes_per_connection) {
+        datagrams += deliver(client, server);
+        datagrams += deliver(server, client);
+        for (auto tuple = server.accept(server_port); tuple.has_value(); tuple = server.accept(server_port)) {
+            accepted.push_back(tuple.value());
+        }
+        for (const auto &tuple : accepted) {
+            const string echo = server.read(tuple, bytes_per_connection);
+            echoed += server.write(tuple, echo);
+        }
+        for (const auto &tuple : tuples) {
+            received += client.read(tuple, bytes_per_connection).size();
+        }
+        client.tick(1);
+        server.tick(1);
+    }
+    // and the last ACKs
+    while (not client.datagrams_out().empty() or not server.datagrams_out().empty()) {
+        datagrams += deliver(client, server);
+        datagrams += deliver(server, client);
+    }
+    const double transfer_seconds = cpu_seconds_since(transfer_start);
+    if (accepted.size() != connections or echoed != received) {
+        throw runtime_error("accepted " + to_string(accepted.size()) + " of " + to_string(connections) +
+                            " connections, echoed " + to_string(echoed) + " bytes, received " +
+                            to_string(received));
+    }
+
+    // let them all sit idle, ticking the stacks every millisecond
+    const clock_t idle_start = clock();
+    for (uint64_t ms = 0; ms < idle_ms; ms++) {
+        datagrams += deliver(client, server);
+        datagrams += deliver(server, client);
+        client.tick(1);
+        server.tick(1);
+    }
+    const double idle_seconds = cpu_seconds_since(idle_start);
+
+    // the same, for pairs of connections ticked one by one
+    const double each_seconds = tick_each(connections);
+
+    cout << fixed << setprecision(2);
+    cout << setw(6) << connections << " connections: " << setw(8) << transfer_seconds * 1e6 / connections
+         << " us CPU/connection to open and echo " << bytes_per_connection << " bytes ("
+         << double(datagrams) / connections << " datagrams/connection), "
+         << setw(8) << idle_seconds * 1e6 / (idle_ms / 1000) << " us CPU/idle second for the stacks vs. "
+         << setw(10) << each_seconds * 1e6 / (idle_ms / 1000) << " ticking each connection\n";
+
+    for (const auto &tuple : tuples) {
+        client.end_input_stream(tuple);
+    }
+    for (const auto &tuple : accepted) {
+        server.end_input_stream(tuple);
+    }
+    while (client.size() > 0 or server.size() > 0) {
+        deliver(client, server);
+        deliver(server, client);
+        client.tick(100);
+        server.tick(100);
+    }
+}
+
+int main() {
+    try {
+        for (const size_t connections : {1, 10, 100, 1000, 10000}) {
+            main_loop(connections);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
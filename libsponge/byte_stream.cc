@@ -1,8 +1,10 @@
 #include "byte_stream.hh"
 
-#include <algorithm>  // std::reverse
+#include <algorithm>
+#include <climits>
 #include <iostream>
 #include <stdexcept>
+#include <sys/ioctl.h>
 
 // Dummy implementation of a flow-controlled in-memory byte stream.
 
@@ -16,13 +18,106 @@ void DUMMY_CODE(Targs &&... /* unused */) {}
 
 using namespace std;
 
-ByteStream::ByteStream(const size_t capacity)
-    : buffer(), buff_capacity(capacity), total_written(0), total_read(0), end_input_called(0) {}
+ByteStream::ByteStream(const size_t capacity, const Storage storage_mode)
+    : storage(storage_mode)
+    , buffer(storage_mode == Storage::Ring ? capacity : 0)
+    , chunks()
+    , buff_capacity(capacity)
+    , buff_head(0)
+    , buff_size(0)
+    , total_written(0)
+    , total_read(0)
+    , end_input_called(0) {}
+
+size_t ByteStream::ring_advance(const size_t pos, const size_t offset) const {
+    // both arguments are < capacity, so one subtraction is enough (and avoids a modulo by zero)
+    const size_t next = pos + offset;
+    return next >= buff_capacity ? next - buff_capacity : next;
+}
 
 size_t ByteStream::write(const string &data) {
+    if (storage == Storage::Ring) {
+        return write_to_ring(data);
+    }
+
+    const string_view accepted = string_view(data).substr(0, remaining_capacity());
+    if (chunks.empty() or accepted.empty() or not chunks.back().try_append(accepted, COALESCE_LIMIT)) {
+        return write(Buffer(string(accepted)));
+    }
+    buff_size += accepted.size();
+    total_written += accepted.size();
+    return accepted.size();
+}
+
+size_t ByteStream::write_to_ring(const string_view data) {
     size_t written_length = min(data.size(), remaining_capacity());
-    buffer.append(data.substr(0, written_length));
+    if (written_length == 0) {
+        return 0;
+    }
 
+    // copy into the free region, which may wrap around the end of the ring
+    const size_t tail = ring_advance(buff_head, buff_size);
+    const size_t first_part = min(written_length, buff_capacity - tail);
+    copy(data.data(), data.data() + first_part, buffer.begin() + tail);
+    copy(data.data() + first_part, data.data() + written_length, buffer.begin());
+
+    buff_size += written_length;
+    total_written += written_length;
+    return written_length;
+}
+
+vector<iovec> ByteStream::free_iovecs(const size_t len) {
+    vector<iovec> ret;
+    const size_t tail = ring_advance(buff_head, buff_size);
+    const size_t first_part = min(len, buff_capacity - tail);
+    if (first_part > 0) {
+        ret.push_back({buffer.data() + tail, first_part});
+    }
+    if (len > first_part) {
+        ret.push_back({buffer.data(), len - first_part});
+    }
+    return ret;
+}
+
+//! \param[in] fd is the file descriptor to read from
+//! \param[in] limit is the maximum number of bytes to read
+size_t ByteStream::write_from(FileDescriptor &fd, const size_t limit) {
+    const size_t size_to_read = min(limit, remaining_capacity());
+
+    if (storage == Storage::Chunked) {
+        // read(2) straight into a new chunk, sized to what the fd has ready if it can say (FIONREAD), so
+        // that nothing is copied and a small read doesn't pin a large allocation
+        int ready = 0;
+        const bool sized = ioctl(fd.fd_num(), FIONREAD, &ready) == 0 and ready > 0;
+        string chunk(sized ? min(size_to_read, static_cast<size_t>(ready)) : size_to_read, 0);
+        chunk.resize(fd.read({{chunk.data(), chunk.size()}}));
+        if (chunk.size() < chunk.capacity() / 2) {
+            chunk.shrink_to_fit();  // it couldn't say, and far fewer bytes arrived than there was room for
+        }
+        return write(Buffer(move(chunk)));
+    }
+
+    const size_t bytes_read = fd.read(free_iovecs(size_to_read));
+    buff_size += bytes_read;
+    total_written += bytes_read;
+    return bytes_read;
+}
+
+//! \param[in] data is kept by reference with Storage::Chunked, and copied into the ring otherwise
+size_t ByteStream::write(Buffer data) {
+    if (storage == Storage::Ring) {
+        return write_to_ring(data.str());
+    }
+
+    size_t written_length = min(data.size(), remaining_capacity());
+    if (written_length == 0) {
+        return 0;
+    }
+
+    data.remove_suffix(data.size() - written_length);
+    chunks.push_back(move(data));
+
+    buff_size += written_length;
     total_written += written_length;
     return written_length;
 }
@@ -30,17 +125,106 @@ size_t ByteStream::write(const string &data) {
 //! \param[in] len bytes will be copied from the output side of the buffer
 string ByteStream::peek_output(const size_t len) const {
     if (len > buffer_size()) {
-        throw std::invalid_argument("len cannot be long than " + buffer_size());
+        throw std::invalid_argument("len cannot be longer than " + to_string(buffer_size()));
+    }
+    string ret;
+    ret.reserve(len);
+
+    if (storage == Storage::Chunked) {
+        for (auto it = chunks.begin(); ret.size() < len; ++it) {
+            ret.append(it->str().substr(0, len - ret.size()));
+        }
+        return ret;
+    }
+
+    const size_t first_part = min(len, buff_capacity - buff_head);
+    ret.append(buffer.data() + buff_head, first_part);
+    ret.append(buffer.data(), len - first_part);
+    return ret;
+}
+
+//! \param[in] len bytes will be shared (Storage::Chunked) or copied (Storage::Ring) from the output side
+BufferList ByteStream::peek_buffers(const size_t len) const {
+    if (storage == Storage::Ring) {
+        return BufferList(peek_output(len));
+    }
+
+    if (len > buffer_size()) {
+        throw std::invalid_argument("len cannot be longer than " + to_string(buffer_size()));
+    }
+    BufferList ret;
+    size_t remaining = len;
+    for (auto it = chunks.begin(); remaining > 0; ++it) {
+        Buffer slice = *it;
+        if (slice.size() > remaining) {
+            slice.remove_suffix(slice.size() - remaining);
+        }
+        remaining -= slice.size();
+        ret.append(slice);
+    }
+    return ret;
+}
+
+//! \param[in] len bytes from the output side of the buffer will be described
+vector<iovec> ByteStream::output_iovecs(const size_t len) const {
+    if (len > buffer_size()) {
+        throw std::invalid_argument("len cannot be longer than " + to_string(buffer_size()));
+    }
+    vector<iovec> ret;
+
+    if (storage == Storage::Chunked) {
+        // one span per chunk, but no more than writev(2) accepts
+        size_t remaining = len;
+        for (auto it = chunks.begin(); remaining > 0 and ret.size() < IOV_MAX; ++it) {
+            const size_t part = min(remaining, it->size());
+            ret.push_back({const_cast<char *>(it->str().data()), part});
+            remaining -= part;
+        }
+        return ret;
+    }
+
+    const size_t first_part = min(len, buff_capacity - buff_head);
+    if (first_part > 0) {
+        ret.push_back({const_cast<char *>(buffer.data()) + buff_head, first_part});
+    }
+    if (len > first_part) {
+        ret.push_back({const_cast<char *>(buffer.data()), len - first_part});
     }
-    return buffer.substr(0, len);
+    return ret;
+}
+
+//! \param[in] fd is the file descriptor to write to
+//! \param[in] limit is the maximum number of bytes to write
+size_t ByteStream::read_into(FileDescriptor &fd, const size_t limit) {
+    const size_t bytes_written = fd.write(output_iovecs(min(limit, buffer_size())), false);
+    pop_output(bytes_written);
+    return bytes_written;
 }
 
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
     if (len > buffer_size()) {
-        throw std::invalid_argument("len cannot be long than " + buffer_size());
+        throw std::invalid_argument("len cannot be longer than " + to_string(buffer_size()));
+    }
+
+    if (storage == Storage::Chunked) {
+        size_t remaining = len;
+        while (remaining > 0) {
+            if (remaining < chunks.front().size()) {
+                chunks.front().remove_prefix(remaining);
+                remaining = 0;
+            } else {
+                remaining -= chunks.front().size();
+                chunks.pop_front();
+            }
+        }
+        buff_size -= len;
+        total_read += len;
+        return;
     }
-    buffer.erase(0, len);
+
+    buff_head = buff_size == len ? 0 : ring_advance(buff_head, len);
+    buff_size -= len;
     total_read += len;
 }
 
@@ -53,11 +237,24 @@ std::string ByteStream::read(const size_t len) {
     return read_output;
 }
 
+//! \param[in] len bytes will be popped and returned
+//! \returns a Buffer that shares the front chunk when possible
+Buffer ByteStream::read_buffer(const size_t len) {
+    if (storage == Storage::Ring or len == 0 or chunks.empty() or chunks.front().size() < len) {
+        return Buffer(read(len));
+    }
+
+    Buffer ret = chunks.front();
+    ret.remove_suffix(ret.size() - len);
+    pop_output(len);
+    return ret;
+}
+
 void ByteStream::end_input() { end_input_called = true; }
 
 bool ByteStream::input_ended() const { return end_input_called; }
 
-size_t ByteStream::buffer_size() const { return buffer.size(); }
+size_t ByteStream::buffer_size() const { return buff_size; }
 
 bool ByteStream::buffer_empty() const { return buffer_size() == 0; }
 
@@ -67,4 +264,17 @@ size_t ByteStream::bytes_written() const { return total_written; }
 
 size_t ByteStream::bytes_read() const { return total_read; }
 
+size_t ByteStream::allocated_bytes() const {
+    if (storage == Storage::Ring) {
+        return buffer.capacity();
+    }
+    size_t ret = 0;
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        if (it == chunks.begin() or not it->shares_storage(*prev(it))) {
+            ret += it->storage_capacity();
+        }
+    }
+    return ret;
+}
+
 size_t ByteStream::remaining_capacity() const { return buff_capacity - buffer_size(); }
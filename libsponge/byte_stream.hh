@@ -1,7 +1,14 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
+#include "buffer.hh"
+#include "file_descriptor.hh"
+
+#include <deque>
 #include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <vector>
 
 //! \brief An in-order byte stream.
 
@@ -9,33 +16,72 @@
 //! side.  The byte stream is finite: the writer can end the input,
 //! and then no more bytes can be written.
 class ByteStream {
+  public:
+    //! How the stream holds the bytes that have been written but not yet read
+    enum class Storage {
+        Ring,    //!< bytes are copied into a preallocated ring of `capacity` bytes
+        Chunked  //!< written Buffers are kept as refcounted slices, so write(Buffer) never copies
+    };
+
   private:
     // Your code here -- add private members as necessary.
-    std::string buffer;
+    Storage storage;
+
+    //! Ring of `buff_capacity` bytes, allocated once at construction (Storage::Ring only).
+    //! The readable bytes start at `buff_head` and wrap around the end.
+    std::vector<char> buffer;
+
+    //! Queue of unread slices (Storage::Chunked only)
+    std::deque<Buffer> chunks;
+
+    //! A string written with Storage::Chunked is appended to the last chunk, rather than queued as a
+    //! new one, if that chunk is unshared and would be no longer than this afterwards
+    static constexpr size_t COALESCE_LIMIT = 4096;
+
     size_t buff_capacity;
+    size_t buff_head;
+    size_t buff_size;
     size_t total_written;
     size_t total_read;
     bool end_input_called;
 
-    // Hint: This doesn't need to be a sophisticated data structure at
-    // all, but if any of your tests are taking longer than a second,
-    // that's a sign that you probably want to keep exploring
-    // different approaches.
+    //! \returns the ring position `offset` bytes past `pos`
+    size_t ring_advance(const size_t pos, const size_t offset) const;
+
+    //! Copy as much of `data` as fits into the ring
+    size_t write_to_ring(const std::string_view data);
+
+    //! \returns up to `len` bytes of free ring space, as at most two spans (Storage::Ring only)
+    std::vector<iovec> free_iovecs(const size_t len);
 
     bool _error{};  //!< Flag indicating that the stream suffered an error.
 
   public:
     //! Construct a stream with room for `capacity` bytes.
-    ByteStream(const size_t capacity);
+    ByteStream(const size_t capacity, const Storage storage_mode = Storage::Ring);
 
     //! \name "Input" interface for the writer
     //!@{
 
     //! Write a string of bytes into the stream. Write as many
     //! as will fit, and return how many were written.
+    //! \note With Storage::Chunked, small writes are coalesced into the last chunk while nothing shares it.
     //! \returns the number of bytes accepted into the stream
     size_t write(const std::string &data);
 
+    //! Write a Buffer into the stream. Write as many bytes as will fit,
+    //! and return how many were written.
+    //! \note With Storage::Chunked the stream keeps a reference to `data`
+    //! instead of copying it, so the underlying storage stays alive until read.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(Buffer data);
+
+    //! Read up to `limit` bytes from `fd` into the stream's storage
+    //! \note Issues one [readv(2)](\ref man2::readv), never reading more than remaining_capacity(), straight
+    //! into the ring (Storage::Ring) or into a new chunk sized to the bytes `fd` has ready (Storage::Chunked).
+    //! \returns the number of bytes accepted into the stream
+    size_t write_from(FileDescriptor &fd, const size_t limit);
+
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
@@ -53,6 +99,21 @@ class ByteStream {
     //! \returns a string
     std::string peek_output(const size_t len) const;
 
+    //! Peek at next "len" bytes of the stream without flattening them
+    //! \note With Storage::Chunked this shares the written Buffers (no copy).
+    //! \returns a BufferList
+    BufferList peek_buffers(const size_t len) const;
+
+    //! \returns up to `len` bytes from the front of the stream as spans over its storage (no copy)
+    //! \note The spans are invalidated by the next write or pop. There are at most IOV_MAX of them, so
+    //! with Storage::Chunked they may describe fewer than `len` bytes.
+    std::vector<iovec> output_iovecs(const size_t len) const;
+
+    //! Write up to `limit` bytes from the stream to `fd` with one [writev(2)](\ref man2::writev),
+    //! and pop what was actually written
+    //! \returns the number of bytes popped
+    size_t read_into(FileDescriptor &fd, const size_t limit);
+
     //! Remove bytes from the buffer
     void pop_output(const size_t len);
 
@@ -60,6 +121,14 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read (i.e., pop) the next "len" bytes of the stream as a Buffer
+    //! \note With Storage::Chunked, if the bytes all come from one written Buffer, the result
+    //! is a slice of it and no copy or allocation is made; otherwise the bytes are copied.
+    Buffer read_buffer(const size_t len);
+
+    //! \returns how the stream stores its bytes
+    Storage storage_mode() const { return storage; }
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -84,6 +153,10 @@ class ByteStream {
 
     //! Total number of bytes popped
     size_t bytes_read() const;
+
+    //! Bytes allocated to hold the unread bytes: the ring, or the strings behind the chunks
+    //! \note A string that consecutive chunks share is counted once.
+    size_t allocated_bytes() const;
     //!@}
 };
 
@@ -0,0 +1,150 @@
+#include "concurrent_byte_stream.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! Create a non-blocking eventfd with a zero count
+static FileDescriptor make_eventfd() { return FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK))); }
+
+//! Add one to the eventfd's count, making it readable
+static void signal_event(const FileDescriptor &event) {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(event.fd_num(), &one, sizeof(one)), EAGAIN);
+}
+
+//! Block until the eventfd is readable, then reset its count to zero
+static void wait_for_event(const FileDescriptor &event) {
+    pollfd pfd{event.fd_num(), POLLIN, 0};
+    SystemCall("poll", ::poll(&pfd, 1, -1), EINTR);
+
+    uint64_t count = 0;
+    SystemCall("read", ::read(event.fd_num(), &count, sizeof(count)), EAGAIN);
+}
+
+ConcurrentByteStream::ConcurrentByteStream(const size_t capacity, const bool use_eventfd)
+    : _buffer(capacity), _capacity(capacity) {
+    if (capacity == 0) {
+        throw invalid_argument("ConcurrentByteStream capacity must be nonzero");
+    }
+    if (use_eventfd) {
+        _readable_event.emplace(make_eventfd());
+        _writable_event.emplace(make_eventfd());
+    }
+}
+
+//! \param[in] data bytes to copy into the ring; only the prefix that fits is written
+size_t ConcurrentByteStream::write(const string_view data) {
+    const uint64_t written = _writer.bytes_written.load(memory_order_relaxed);
+
+    // only look at the reader's cache line when the stale snapshot says we're out of room
+    size_t free_space = _capacity - (written - _writer.cached_bytes_read);
+    if (free_space < data.size()) {
+        _writer.cached_bytes_read = _reader.bytes_read.load(memory_order_acquire);
+        free_space = _capacity - (written - _writer.cached_bytes_read);
+    }
+
+    const size_t len = min(data.size(), free_space);
+    if (len == 0) {
+        return 0;
+    }
+
+    const size_t tail = written % _capacity;
+    const size_t first_part = min(len, _capacity - tail);
+    copy(data.data(), data.data() + first_part, _buffer.begin() + tail);
+    copy(data.data() + first_part, data.data() + len, _buffer.begin());
+
+    _writer.bytes_written.store(written + len);
+
+    // wake the reader only if the ring was empty before this write
+    if (_readable_event and _reader.bytes_read.load() == written) {
+        signal_event(_readable_event.value());
+    }
+
+    return len;
+}
+
+size_t ConcurrentByteStream::remaining_capacity() const {
+    return _capacity - (_writer.bytes_written.load() - _reader.bytes_read.load());
+}
+
+void ConcurrentByteStream::end_input() {
+    _input_ended.store(true);
+    if (_readable_event) {
+        signal_event(_readable_event.value());
+    }
+}
+
+void ConcurrentByteStream::wait_writable() {
+    if (not _writable_event) {
+        throw runtime_error("ConcurrentByteStream::wait_writable() requires use_eventfd");
+    }
+    while (remaining_capacity() == 0 and not error()) {
+        wait_for_event(_writable_event.value());
+    }
+}
+
+//! \param[in] len the maximum number of bytes to pop and return
+string ConcurrentByteStream::read(const size_t len) {
+    const uint64_t read_so_far = _reader.bytes_read.load(memory_order_relaxed);
+
+    size_t available = _reader.cached_bytes_written - read_so_far;
+    if (available < len) {
+        _reader.cached_bytes_written = _writer.bytes_written.load(memory_order_acquire);
+        available = _reader.cached_bytes_written - read_so_far;
+    }
+
+    const size_t size_to_read = min(len, available);
+    if (size_to_read == 0) {
+        return {};
+    }
+
+    string ret;
+    ret.reserve(size_to_read);
+    const size_t head = read_so_far % _capacity;
+    const size_t first_part = min(size_to_read, _capacity - head);
+    ret.append(_buffer.data() + head, first_part);
+    ret.append(_buffer.data(), size_to_read - first_part);
+
+    _reader.bytes_read.store(read_so_far + size_to_read);
+
+    // wake the writer only if the ring was full before this read
+    if (_writable_event and _writer.bytes_written.load() - read_so_far == _capacity) {
+        signal_event(_writable_event.value());
+    }
+
+    return ret;
+}
+
+size_t ConcurrentByteStream::buffer_size() const {
+    return _writer.bytes_written.load() - _reader.bytes_read.load();
+}
+
+bool ConcurrentByteStream::eof() const {
+    // check input_ended() first: a write that precedes end_input() is then guaranteed to be visible
+    return input_ended() and buffer_empty();
+}
+
+void ConcurrentByteStream::wait_readable() {
+    if (not _readable_event) {
+        throw runtime_error("ConcurrentByteStream::wait_readable() requires use_eventfd");
+    }
+    while (buffer_empty() and not input_ended() and not error()) {
+        wait_for_event(_readable_event.value());
+    }
+}
+
+void ConcurrentByteStream::set_error() {
+    _error.store(true);
+    if (_readable_event) {
+        signal_event(_readable_event.value());
+        signal_event(_writable_event.value());
+    }
+}
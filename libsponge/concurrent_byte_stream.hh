@@ -0,0 +1,124 @@
+#ifndef SPONGE_LIBSPONGE_CONCURRENT_BYTE_STREAM_HH
+#define SPONGE_LIBSPONGE_CONCURRENT_BYTE_STREAM_HH
+
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! \brief An in-order byte stream shared by exactly one writer thread and one reader thread.
+
+//! Like ByteStream, bytes are written on the "input" side and read from the
+//! "output" side, but the two sides may run on different threads without locks
+//! or system calls. The stream is a ring of `capacity` bytes indexed by two
+//! monotonic counters: the writer only stores `bytes_written` and the reader only
+//! stores `bytes_read`, each on its own cache line.
+//!
+//! If constructed with `use_eventfd`, the stream also keeps two
+//! [eventfd(2)](\ref man2::eventfd)s so that a side that would otherwise spin can
+//! block. The writer signals "readable" only when it writes into an empty ring, and
+//! the reader signals "writable" only when it frees space in a full ring, so a
+//! steadily flowing stream makes no system calls.
+class ConcurrentByteStream {
+  private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    //! State written by the writer thread (plus its snapshot of the reader's counter)
+    struct alignas(CACHE_LINE_SIZE) WriterState {
+        std::atomic<uint64_t> bytes_written{0};
+        uint64_t cached_bytes_read{0};  //!< possibly stale copy of ReaderState::bytes_read
+    };
+
+    //! State written by the reader thread (plus its snapshot of the writer's counter)
+    struct alignas(CACHE_LINE_SIZE) ReaderState {
+        std::atomic<uint64_t> bytes_read{0};
+        uint64_t cached_bytes_written{0};  //!< possibly stale copy of WriterState::bytes_written
+    };
+
+    std::vector<char> _buffer;
+    size_t _capacity;
+
+    WriterState _writer{};
+    ReaderState _reader{};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> _input_ended{false};
+    std::atomic<bool> _error{false};
+
+    std::optional<FileDescriptor> _readable_event{};  //!< signaled when data (or EOF) becomes available
+    std::optional<FileDescriptor> _writable_event{};  //!< signaled when space becomes available
+
+  public:
+    //! Construct a stream with room for `capacity` bytes
+    //! \param capacity the size of the ring (must be nonzero)
+    //! \param use_eventfd whether to create eventfds so either side can block in wait_readable()/wait_writable()
+    explicit ConcurrentByteStream(const size_t capacity, const bool use_eventfd = false);
+
+    //! \name "Input" interface for the writer thread
+    //!@{
+
+    //! Write as many bytes of `data` as will fit
+    //! \returns the number of bytes accepted into the stream
+    size_t write(const std::string_view data);
+
+    //! \returns the number of additional bytes that the stream has space for
+    size_t remaining_capacity() const;
+
+    //! Signal that the byte stream has reached its ending
+    void end_input();
+
+    //! Block until remaining_capacity() > 0 or error() (requires `use_eventfd`)
+    void wait_writable();
+    //!@}
+
+    //! \name "Output" interface for the reader thread
+    //!@{
+
+    //! Read (i.e., copy and then pop) up to `len` bytes of the stream
+    //! \returns a string of at most `len` bytes, which is empty if nothing was available
+    std::string read(const size_t len);
+
+    //! \returns the number of bytes that can currently be read
+    size_t buffer_size() const;
+
+    //! \returns `true` if the buffer is empty
+    bool buffer_empty() const { return buffer_size() == 0; }
+
+    //! \returns `true` if the output has reached the ending
+    bool eof() const;
+
+    //! Block until buffer_size() > 0, eof() or error() (requires `use_eventfd`)
+    void wait_readable();
+    //!@}
+
+    //! \name Accessors usable from either thread
+    //!@{
+
+    //! Indicate that the stream suffered an error (wakes up both sides)
+    void set_error();
+
+    //! \returns `true` if the stream has suffered an error
+    bool error() const { return _error.load(); }
+
+    //! \returns `true` if the stream input has ended
+    bool input_ended() const { return _input_ended.load(); }
+
+    //! Total number of bytes written
+    size_t bytes_written() const { return _writer.bytes_written.load(); }
+
+    //! Total number of bytes popped
+    size_t bytes_read() const { return _reader.bytes_read.load(); }
+
+    //! \brief eventfd that becomes readable when data, EOF or an error is available to the reader
+    //! \note Only present with `use_eventfd`; may be polled by an EventLoop instead of calling wait_readable()
+    const std::optional<FileDescriptor> &readable_event() const { return _readable_event; }
+
+    //! \brief eventfd that becomes readable when space is available to the writer
+    const std::optional<FileDescriptor> &writable_event() const { return _writable_event; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_CONCURRENT_BYTE_STREAM_HH
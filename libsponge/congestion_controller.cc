@@ -0,0 +1,118 @@
+#include "congestion_controller.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+//! RFC 6928's initial window: min(10 * MSS, max(2 * MSS, 14600 bytes))
+static size_t initial_window(const size_t mss) { return min(10 * mss, max(2 * mss, size_t{14600})); }
+
+//! \param[in] algorithm the algorithm selected in the TCPConfig
+//! \param[in] mss the sender's maximum payload size
+unique_ptr<CongestionController> CongestionController::make(const TCPConfig::CongestionControl algorithm,
+                                                            const size_t mss) {
+    switch (algorithm) {
+        case TCPConfig::CongestionControl::NewReno:
+            return make_unique<NewReno>(mss);
+        case TCPConfig::CongestionControl::Cubic:
+            return make_unique<Cubic>(mss);
+        case TCPConfig::CongestionControl::None:
+            break;
+    }
+    return nullptr;
+}
+
+optional<double> CongestionController::pacing_rate(const optional<double> srtt) const {
+    if (not srtt.has_value()) {
+        return {};
+    }
+    const double ratio = cwnd() < ssthresh() ? 2.0 : 1.2;
+    return ratio * double(cwnd()) / max(1.0, srtt.value());
+}
+
+NewReno::NewReno(const size_t mss)
+    : CongestionController(mss), _cwnd(initial_window(mss)), _ssthresh(numeric_limits<size_t>::max()) {}
+
+void NewReno::on_ack(const size_t bytes_acked, const size_t, const optional<double>) {
+    if (_cwnd < _ssthresh) {
+        // slow start, with appropriate byte counting limited to one MSS per ACK
+        _cwnd += min(bytes_acked, _mss);
+        return;
+    }
+
+    // congestion avoidance: one MSS for each window's worth of acked bytes
+    _bytes_acked += bytes_acked;
+    if (_bytes_acked >= _cwnd) {
+        _bytes_acked -= _cwnd;
+        _cwnd += _mss;
+    }
+}
+
+void NewReno::on_loss(const size_t bytes_in_flight, const size_t) {
+    _ssthresh = max(bytes_in_flight / 2, 2 * _mss);
+    _cwnd = _ssthresh;
+    _bytes_acked = 0;
+}
+
+void NewReno::on_rto(const size_t bytes_in_flight, const size_t) {
+    _ssthresh = max(bytes_in_flight / 2, 2 * _mss);
+    _cwnd = _mss;
+    _bytes_acked = 0;
+}
+
+Cubic::Cubic(const size_t mss)
+    : CongestionController(mss), _cwnd(initial_window(mss)), _ssthresh(numeric_limits<size_t>::max()) {}
+
+void Cubic::on_ack(const size_t bytes_acked, const size_t now, const optional<double> srtt) {
+    if (_cwnd < _ssthresh) {
+        _cwnd += min(bytes_acked, _mss);
+        return;
+    }
+
+    const double segments = _cwnd / _mss;
+    if (not _epoch_start.has_value()) {
+        _epoch_start = now;
+        if (_w_max > segments) {
+            _k = cbrt((_w_max - segments) / C);
+            _origin = _w_max;
+        } else {
+            _k = 0;
+            _origin = segments;
+        }
+        _w_est = segments;
+    }
+
+    // aim for where the cubic function will be one RTT from now
+    const double t = double(now - _epoch_start.value() + srtt.value_or(0)) / 1000;
+    double target = _origin + C * pow(t - _k, 3);
+
+    // TCP-friendly region: grow at least as fast as Reno with the same beta would
+    _w_est += 3 * (1 - BETA) / (1 + BETA) * (double(bytes_acked) / _mss) / segments;
+    target = max(target, _w_est);
+
+    // grow towards the target over the next window of ACKs, by at most half a window per RTT
+    target = min(target, 1.5 * segments);
+    if (target > segments) {
+        _cwnd += _mss * (target - segments) / segments * (double(bytes_acked) / _mss);
+    }
+}
+
+void Cubic::reduce() {
+    _epoch_start.reset();
+    const double segments = _cwnd / _mss;
+    // fast convergence: release bandwidth sooner if the window shrank since the last loss
+    _w_max = segments < _w_max ? segments * (1 + BETA) / 2 : segments;
+    _ssthresh = max(static_cast<size_t>(_cwnd * BETA), 2 * _mss);
+}
+
+void Cubic::on_loss(const size_t, const size_t) {
+    reduce();
+    _cwnd = _ssthresh;
+}
+
+void Cubic::on_rto(const size_t, const size_t) {
+    reduce();
+    _cwnd = _mss;
+}
@@ -0,0 +1,114 @@
+#ifndef SPONGE_LIBSPONGE_CONGESTION_CONTROLLER_HH
+#define SPONGE_LIBSPONGE_CONGESTION_CONTROLLER_HH
+
+#include "tcp_config.hh"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+//! \brief A congestion control algorithm, consulted by the TCPSender
+
+//! The sender keeps at most min(cwnd(), the receiver's window) bytes in flight, and
+//! reports acknowledgments, detected losses and retransmission timeouts through the
+//! `on_*` hooks. Sizes are in bytes and times in milliseconds, as counted by
+//! TCPSender::tick().
+class CongestionController {
+  protected:
+    size_t _mss;  //!< maximum segment size, the unit the algorithms grow and shrink in
+
+  public:
+    //! \param[in] mss the sender's maximum payload size
+    explicit CongestionController(const size_t mss) : _mss(mss) {}
+    virtual ~CongestionController() = default;
+
+    //! Create the controller that a TCPConfig asks for (null for TCPConfig::CongestionControl::None)
+    static std::unique_ptr<CongestionController> make(const TCPConfig::CongestionControl algorithm,
+                                                      const size_t mss);
+
+    //! \returns the congestion window: how many bytes may be in flight
+    virtual size_t cwnd() const = 0;
+
+    //! \returns the slow-start threshold
+    virtual size_t ssthresh() const = 0;
+
+    //! \brief The rate at which to space out segments, in bytes per millisecond
+    //! \details The default spreads a window over one SRTT, twice as fast in slow start (as Linux does)
+    //! \returns the rate, or empty if there is no RTT estimate yet
+    virtual std::optional<double> pacing_rate(const std::optional<double> srtt) const;
+
+    //! \brief New data was acknowledged
+    //! \param[in] bytes_acked the number of bytes newly acknowledged
+    //! \param[in] now the sender's clock
+    //! \param[in] srtt the sender's smoothed RTT, if it has one
+    virtual void on_ack(const size_t bytes_acked, const size_t now, const std::optional<double> srtt) = 0;
+
+    //! \brief A loss was inferred from the acknowledgments (e.g. duplicate ACKs)
+    //! \param[in] bytes_in_flight the bytes outstanding when the loss was detected
+    virtual void on_loss(const size_t bytes_in_flight, const size_t now) = 0;
+
+    //! \brief The retransmission timer expired
+    //! \param[in] bytes_in_flight the bytes outstanding when the timer expired
+    virtual void on_rto(const size_t bytes_in_flight, const size_t now) = 0;
+
+    //! \returns the algorithm's name, for reporting
+    virtual std::string name() const = 0;
+};
+
+//! \brief NewReno congestion control (RFC 5681 and RFC 6582)
+
+//! Slow start grows the window by up to one MSS per ACK, congestion avoidance by about
+//! one MSS per window (counting bytes, as in RFC 3465), and a loss halves the window.
+class NewReno : public CongestionController {
+  private:
+    size_t _cwnd;
+    size_t _ssthresh;
+    size_t _bytes_acked{0};  //!< acked bytes not yet turned into congestion-avoidance growth
+
+  public:
+    //! Start with the initial window of RFC 6928, and an unbounded ssthresh
+    explicit NewReno(const size_t mss);
+
+    size_t cwnd() const override { return _cwnd; }
+    size_t ssthresh() const override { return _ssthresh; }
+    void on_ack(const size_t bytes_acked, const size_t now, const std::optional<double> srtt) override;
+    void on_loss(const size_t bytes_in_flight, const size_t now) override;
+    void on_rto(const size_t bytes_in_flight, const size_t now) override;
+    std::string name() const override { return "NewReno"; }
+};
+
+//! \brief CUBIC congestion control (RFC 8312)
+
+//! After a loss, the window follows W(t) = C * (t - K)^3 + W_max, a cubic function of the
+//! time since the loss that plateaus at the window where the loss happened, and never
+//! grows slower than an estimate of what Reno would reach in the same time.
+class Cubic : public CongestionController {
+  private:
+    static constexpr double C = 0.4;     //!< scaling constant, in segments per second cubed
+    static constexpr double BETA = 0.7;  //!< multiplicative decrease factor
+
+    double _cwnd;  //!< in bytes, kept fractional so that sub-byte growth per ACK adds up
+    size_t _ssthresh;
+    double _w_max{0};                     //!< window (in segments) just before the last reduction
+    std::optional<size_t> _epoch_start{};  //!< when the current congestion-avoidance epoch began
+    double _k{0};                         //!< seconds the cubic function takes to climb back to its origin
+    double _origin{0};                    //!< the plateau of the cubic function, in segments
+    double _w_est{0};                     //!< the Reno-friendly window estimate, in segments
+
+    //! Reduce the window after a loss (ssthresh = cwnd * BETA), with fast convergence
+    void reduce();
+
+  public:
+    //! Start with the initial window of RFC 6928, and an unbounded ssthresh
+    explicit Cubic(const size_t mss);
+
+    size_t cwnd() const override { return static_cast<size_t>(_cwnd); }
+    size_t ssthresh() const override { return _ssthresh; }
+    void on_ack(const size_t bytes_acked, const size_t now, const std::optional<double> srtt) override;
+    void on_loss(const size_t bytes_in_flight, const size_t now) override;
+    void on_rto(const size_t bytes_in_flight, const size_t now) override;
+    std::string name() const override { return "CUBIC"; }
+};
+
+#endif  // SPONGE_LIBSPONGE_CONGESTION_CONTROLLER_HH
@@ -1,7 +1,7 @@
 #include "stream_reassembler.hh"
 
-#include <iostream>
-#include <queue>
+#include <algorithm>
+#include <iterator>
 
 // Dummy implementation of a stream reassembler.
 
@@ -15,171 +15,336 @@ void DUMMY_CODE(Targs &&... /* unused */) {}
 
 using namespace std;
 
-StreamReassembler::StreamReassembler(const size_t capacity)
-    : _output(capacity)
+namespace {
+constexpr size_t WORD_BITS = 64;
+
+//! \returns a word with bits [bit, bit + count) set
+uint64_t bit_mask(const size_t bit, const size_t count) {
+    return (count == WORD_BITS ? ~uint64_t{0} : ((uint64_t{1} << count) - 1)) << bit;
+}
+}  // namespace
+
+StreamReassembler::StreamReassembler(const size_t capacity,
+                                     const Storage storage_mode,
+                                     const ByteStream::Storage output_storage)
+    : _output(capacity, output_storage)
     , _capacity(capacity)
+    , storage(storage_mode)
     , data_container({})
-    , index_queue()
+    , ring_buffer(storage_mode == Storage::Ring ? capacity : 0)
+    , ring_bitmap(storage_mode == Storage::Ring ? (capacity + WORD_BITS - 1) / WORD_BITS : 0)
+    , ring_scratch()
+    , ring_recent()
+    , ring_recent_count(0)
+    , recent_ranges()
+    , ranges_by_start()
     , next_expected_index(0)
     , end_index(0)
     , ended(0)
-    , current_unassembled_bytes(0) {}
+    , current_unassembled_bytes(0) {
+    if (storage == Storage::Ring) {
+        ring_scratch.reserve(capacity);  // so that flushing never has to grow it
+    }
+}
 
 //! \details This function accepts a substring (aka a segment) of bytes,
 //! possibly out-of-order, from the logical stream, and assembles any newly
 //! contiguous substrings and writes them into the output stream in order.
-void StreamReassembler::push_substring(const string &data, const size_t index, const bool eof) {
-    // check if substring (starts with index, ends with new_upper_bound) is already received.
-    size_t new_upper_bound = index + data.size() - 1;
-    if (data.size() == 0) {
-        new_upper_bound = index;
+void StreamReassembler::push_substring(const string &data, const uint64_t index, const bool eof) {
+    const auto [start, end] = acceptable_range(index, data.size(), eof);
+    if (start < end and storage == Storage::Map) {
+        // copy only the part that will be kept
+        insert_into_map(Buffer(data.substr(start - index, end - start)), start);
+    } else if (start < end) {
+        insert_into_ring(string_view(data).substr(start - index, end - start), start);
     }
-    if (new_upper_bound < next_expected_index) {
-        return;
+    touch_range(start, end);
+    flush();
+}
+
+//! \details Like push_substring(const std::string&, ...), but Storage::Map keeps a slice of
+//! `data` itself (sharing its storage) rather than a copy.
+void StreamReassembler::push_substring(Buffer data, const uint64_t index, const bool eof) {
+    const auto [start, end] = acceptable_range(index, data.size(), eof);
+    if (start < end) {
+        data.remove_suffix(index + data.size() - end);
+        data.remove_prefix(start - index);
+        if (storage == Storage::Map) {
+            insert_into_map(move(data), start);
+        } else {
+            insert_into_ring(data.str(), start);
+        }
     }
+    touch_range(start, end);
+    flush();
+}
 
-    // check eof
+pair<uint64_t, uint64_t> StreamReassembler::acceptable_range(const uint64_t index,
+                                                             const size_t size,
+                                                             const bool eof) {
     if (eof) {
-        end_index = index + data.size();
+        end_index = index + size;
         ended = true;
     }
 
-    // truncate the part that we already recieved
-    size_t valid_index = max(index, next_expected_index);
-    const string &valid_data = data.substr(valid_index - index);
-    data_container[valid_index] = valid_data;
-    index_queue.push(valid_index);
-
-    // check capacity
-    size_t remaining_capacity_for_unassemble = _capacity - _output.buffer_size();
-    size_t current_upper_index = 0;
-    size_t unassembled_bytes = 0;
-    bool overload = false;
-    bool load_first_byte = false;
-
-    while (not index_queue.empty()) {
-        size_t next_lower_index = index_queue.top();
-        size_t next_upper_index = next_lower_index + data_container[next_lower_index].size() - 1;
-        index_queue.pop();
-
-        // duplicate substring stored in re-assembler, remove it
-        if (next_upper_index < current_upper_index) {
-            data_container.erase(next_lower_index);
-            continue;
-        }
+    // only keep the part that is new and fits in the window
+    const uint64_t first_unacceptable = _output.bytes_read() + _capacity;
+    return {max(index, next_expected_index), min(index + size, first_unacceptable)};
+}
+
+void StreamReassembler::flush() {
+    // the window guarantees that everything stored fits in the output
+    if (storage == Storage::Map) {
+        flush_map();
+    } else {
+        flush_ring();
+    }
+
+    // the range that just became contiguous (if any) is no longer out of order
+    while (not ranges_by_start.empty() and ranges_by_start.begin()->first <= next_expected_index) {
+        recent_ranges.erase(ranges_by_start.begin()->second);
+        ranges_by_start.erase(ranges_by_start.begin());
+    }
+
+    if (ended && next_expected_index >= end_index) {
+        _output.end_input();
+    }
+}
+
+//! \details Merges [start, end) with every held range it overlaps or abuts, and moves the
+//! result to the front of the recency list. In-order substrings are skipped: flush() is
+//! about to assemble them along with any range they reach.
+void StreamReassembler::touch_range(uint64_t start, uint64_t end) {
+    if (start >= end or start == next_expected_index) {
+        return;
+    }
+    if (storage == Storage::Ring) {
+        touch_ring_range(start);
+        return;
+    }
 
-        // exceed capacity, remove all substrings
-        if (overload) {
-            data_container.erase(next_lower_index);
-            continue;
+    auto it = ranges_by_start.upper_bound(start);
+    if (it != ranges_by_start.begin() and std::prev(it)->second->second >= start) {
+        --it;
+    }
+    while (it != ranges_by_start.end() and it->first <= end) {
+        start = min(start, it->second->first);
+        end = max(end, it->second->second);
+        recent_ranges.erase(it->second);
+        it = ranges_by_start.erase(it);
+    }
+
+    recent_ranges.emplace_front(start, end);
+    ranges_by_start.emplace_hint(it, start, recent_ranges.begin());
+}
+
+//! \details The ring's version of touch_range(), which allocates nothing: the range holding `start`
+//! is read off the presence bitmap, any remembered index inside it is forgotten (it's the same
+//! range, perhaps merged since), and `start` goes first, pushing out the least recent.
+void StreamReassembler::touch_ring_range(const uint64_t start) {
+    const auto [run_start, run_end] = ring_run(start);
+    size_t kept = 0;
+    for (size_t i = 0; i < ring_recent_count; ++i) {
+        const uint64_t index = ring_recent[i];
+        if (index >= next_expected_index and (index < run_start or index >= run_end)) {
+            ring_recent[kept++] = index;
         }
+    }
+    ring_recent_count = min(kept + 1, RING_RECENT_RANGES);
+    copy_backward(ring_recent.begin(), ring_recent.begin() + ring_recent_count - 1,
+                  ring_recent.begin() + ring_recent_count);
+    ring_recent[0] = start;
+}
 
-        if (load_first_byte && next_lower_index <= current_upper_index) {
-            // overlapping
-
-            // if exceed capacity, we need to truncate the data to fit the remaining capacity
-            if (unassembled_bytes + next_upper_index - current_upper_index + 1 > remaining_capacity_for_unassemble) {
-                data_container[current_upper_index + 1] = data_container[next_lower_index].substr(
-                    next_upper_index - current_upper_index - 1, remaining_capacity_for_unassemble - unassembled_bytes);
-                data_container.erase(next_lower_index);
-                overload = true;
-                unassembled_bytes += data_container[current_upper_index + 1].size();
-                current_upper_index = current_upper_index + data_container[current_upper_index + 1].size();
-            } else {
-                // no need to truncate
-                unassembled_bytes += next_upper_index - current_upper_index + 1;
-                current_upper_index = next_lower_index + data_container[next_lower_index].size() - 1;
-            }
-        } else {
-            // no overlapping
+pair<uint64_t, uint64_t> StreamReassembler::ring_run(const uint64_t index) const {
+    const size_t slot = index % _capacity;
+
+    // forward to the end of the window, and back to the next expected index; either may wrap
+    const uint64_t ahead = _output.bytes_read() + _capacity - index;
+    size_t forward = present_run(slot, min<uint64_t>(ahead, _capacity - slot));
+    if (forward == _capacity - slot and ahead > forward) {
+        forward += present_run(0, ahead - forward);
+    }
+    const uint64_t behind = index - next_expected_index;
+    size_t back = present_run_back(slot, min<uint64_t>(behind, slot));
+    if (back == slot and behind > back) {
+        back += present_run_back(_capacity, behind - back);
+    }
+    return {index - back, index + forward};
+}
 
-            // if exceed capacity, we need to truncate the data to fit the remaining capacity
-            if (unassembled_bytes + data_container[next_lower_index].size() > remaining_capacity_for_unassemble) {
-                data_container[next_lower_index] =
-                    data_container[next_lower_index].substr(0, remaining_capacity_for_unassemble - unassembled_bytes);
-                overload = true;
+vector<pair<uint64_t, uint64_t>> StreamReassembler::held_ranges(const size_t max_blocks) const {
+    vector<pair<uint64_t, uint64_t>> ret;
+    if (storage == Storage::Ring) {
+        for (size_t i = 0; i < ring_recent_count and ret.size() < max_blocks; ++i) {
+            if (ring_recent[i] >= next_expected_index) {
+                ret.push_back(ring_run(ring_recent[i]));
             }
-            unassembled_bytes += data_container[next_lower_index].size();
-            current_upper_index = next_lower_index + data_container[next_lower_index].size() - 1;
         }
-        load_first_byte = true;
+        return ret;
     }
 
-    for (auto &p : data_container) {
-        index_queue.push(p.first);
+    for (auto it = recent_ranges.begin(); it != recent_ranges.end() and ret.size() < max_blocks; ++it) {
+        ret.push_back(*it);
     }
+    return ret;
+}
 
-    // read data
-    size_t min_index = index_queue.top();
-    while (not index_queue.empty() && min_index <= next_expected_index) {
-        const string &next_reassembled_data_candidate = data_container[min_index];
+//! \details Runs in O(log n + k) for n stored substrings, k of which are covered by the
+//! new one: partially-overlapping neighbours trim the new substring, and substrings it
+//! covers completely are replaced by it. Trimming only adjusts the Buffer's bounds.
+void StreamReassembler::insert_into_map(Buffer data, const uint64_t start) {
+    uint64_t end = start + data.size();
 
-        // already assembled the data, remove it from re-assembler
-        if ((min_index + next_reassembled_data_candidate.size()) < next_expected_index) {
-            data_container.erase(min_index);
-            index_queue.pop();
-        } else {
-            const string &next_reassembled_data =
-                next_reassembled_data_candidate.substr(next_expected_index - min_index);
-
-            if (next_reassembled_data.size() <= _output.remaining_capacity()) {
-                // can read into output ByteStream
-                data_container.erase(min_index);
-                index_queue.pop();
-                _output.write(next_reassembled_data);
-                next_expected_index += next_reassembled_data.size();
-            } else {
-                // longer than the remain capacity of output BytesStream
-                data_container.erase(min_index);
-                index_queue.pop();
-                // only writes the portion can fit into the capacity of output BytesStream
-                _output.write(next_reassembled_data.substr(0, _output.remaining_capacity()));
-                next_expected_index += _output.remaining_capacity();
-                // push the left portion back
-                data_container[next_expected_index] = next_reassembled_data.substr(next_expected_index - min_index);
-                index_queue.push(next_expected_index);
-            }
+    // the last stored substring beginning at or before `start` may overlap its front
+    auto it = data_container.upper_bound(start);
+    if (it != data_container.begin()) {
+        const auto prev = std::prev(it);
+        const uint64_t prev_end = prev->first + prev->second.size();
+        if (prev_end >= end) {
+            return;  // already have every byte
         }
+        if (prev_end > start) {
+            data.remove_prefix(prev_end - start);
+        }
+    }
+    const uint64_t new_start = end - data.size();
 
-        if (_output.remaining_capacity() == 0) {
+    // drop stored substrings that the new one covers; one that sticks out past `end` trims it
+    while (it != data_container.end() && it->first < end) {
+        const uint64_t it_end = it->first + it->second.size();
+        if (it_end > end) {
+            data.remove_suffix(end - it->first);
+            end = it->first;
             break;
         }
+        current_unassembled_bytes -= it->second.size();
+        it = data_container.erase(it);
+    }
 
-        min_index = index_queue.top();
+    if (new_start < end) {
+        current_unassembled_bytes += data.size();
+        data_container.emplace_hint(it, new_start, move(data));
     }
+}
 
-    // check end
-    if (ended && next_expected_index >= end_index) {
-        _output.end_input();
+void StreamReassembler::flush_map() {
+    while (not data_container.empty() && data_container.begin()->first == next_expected_index) {
+        const auto it = data_container.begin();
+        _output.write(it->second);
+        next_expected_index += it->second.size();
+        current_unassembled_bytes -= it->second.size();
+        data_container.erase(it);
+    }
+}
+
+//! \details Copies the new bytes into their ring slots (overwriting duplicates with the
+//! same bytes) and counts only the slots whose presence bit was not already set.
+void StreamReassembler::insert_into_ring(const string_view data, const uint64_t start) {
+    const size_t len = data.size();
+    const size_t slot = start % _capacity;
+    const size_t first_part = min(len, _capacity - slot);
+    const char *src = data.data();
+
+    copy(src, src + first_part, ring_buffer.begin() + slot);
+    copy(src + first_part, src + len, ring_buffer.begin());
+    current_unassembled_bytes += mark_present(slot, first_part);
+    current_unassembled_bytes += mark_present(0, len - first_part);
+}
+
+void StreamReassembler::flush_ring() {
+    if (_capacity == 0) {
+        return;
+    }
+
+    // find the run of present bytes starting at the next expected index, which may wrap
+    const size_t slot = next_expected_index % _capacity;
+    const size_t first_part = present_run(slot, _capacity - slot);
+    const size_t second_part = first_part == _capacity - slot ? present_run(0, slot) : 0;
+    if (first_part == 0) {
+        return;
+    }
+
+    ring_scratch.assign(ring_buffer.data() + slot, first_part);
+    ring_scratch.append(ring_buffer.data(), second_part);
+    mark_absent(slot, first_part);
+    mark_absent(0, second_part);
+
+    _output.write(ring_scratch);
+    next_expected_index += ring_scratch.size();
+    current_unassembled_bytes -= ring_scratch.size();
+}
+
+size_t StreamReassembler::mark_present(size_t slot, size_t count) {
+    size_t newly_present = 0;
+    while (count > 0) {
+        const size_t bit = slot % WORD_BITS;
+        const size_t n = min(count, WORD_BITS - bit);
+        const uint64_t mask = bit_mask(bit, n);
+        uint64_t &word = ring_bitmap[slot / WORD_BITS];
+        newly_present += __builtin_popcountll(mask & ~word);
+        word |= mask;
+        slot += n;
+        count -= n;
     }
+    return newly_present;
+}
 
-    // calculate number of unassembled bytes
-    size_t upper_index = 0;
-    current_unassembled_bytes = 0;
-    while (not index_queue.empty()) {
-        size_t next_index = index_queue.top();
-        size_t new_upper_index = next_index + data_container[next_index].size() - 1;
-        index_queue.pop();
+void StreamReassembler::mark_absent(size_t slot, size_t count) {
+    while (count > 0) {
+        const size_t bit = slot % WORD_BITS;
+        const size_t n = min(count, WORD_BITS - bit);
+        ring_bitmap[slot / WORD_BITS] &= ~bit_mask(bit, n);
+        slot += n;
+        count -= n;
+    }
+}
 
-        if (new_upper_index < upper_index) {
-            data_container.erase(next_index);
-            continue;
+size_t StreamReassembler::present_run(const size_t slot, const size_t limit) const {
+    size_t run = 0;
+    while (run < limit) {
+        const size_t bit = (slot + run) % WORD_BITS;
+        // the shift fills the top with zeros, so this has a bit set at or before the end of the word
+        const uint64_t absent = ~(ring_bitmap[(slot + run) / WORD_BITS] >> bit);
+        const size_t n = absent == 0 ? WORD_BITS : __builtin_ctzll(absent);
+        run += n;
+        if (n < WORD_BITS - bit) {
+            break;
         }
-        if (next_index <= upper_index) {
-            // overlapping
-            current_unassembled_bytes += new_upper_index - upper_index;
-        } else {
-            current_unassembled_bytes += data_container[next_index].size();
+    }
+    return min(run, limit);
+}
+
+//! \param[in] slot is one past the last bit to look at
+size_t StreamReassembler::present_run_back(const size_t slot, const size_t limit) const {
+    size_t run = 0;
+    while (run < limit) {
+        const size_t last = slot - run - 1;
+        const size_t bit = last % WORD_BITS;
+        // the shift fills the bottom with zeros, so this has a bit set at or above the bottom of the word
+        const uint64_t absent = ~(ring_bitmap[last / WORD_BITS] << (WORD_BITS - 1 - bit));
+        const size_t n = absent == 0 ? WORD_BITS : __builtin_clzll(absent);
+        run += n;
+        if (n < bit + 1) {
+            break;
         }
-        upper_index = next_index + data_container[next_index].size() - 1;
     }
+    return min(run, limit);
+}
 
-    // push all left data index back to queue
-    for (auto &p : data_container) {
-        index_queue.push(p.first);
+size_t StreamReassembler::allocated_bytes() const {
+    if (storage == Storage::Ring) {
+        return ring_buffer.capacity() + ring_bitmap.capacity() * sizeof(uint64_t) + ring_scratch.capacity();
+    }
+    size_t ret = 0;
+    for (auto it = data_container.begin(); it != data_container.end(); ++it) {
+        if (it == data_container.begin() or not it->second.shares_storage(std::prev(it)->second)) {
+            ret += it->second.storage_capacity();
+        }
     }
+    return ret;
 }
 
 size_t StreamReassembler::unassembled_bytes() const { return current_unassembled_bytes; }
 
-bool StreamReassembler::empty() const { return _output.buffer_empty(); }
+bool StreamReassembler::empty() const { return current_unassembled_bytes == 0; }
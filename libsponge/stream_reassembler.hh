@@ -3,32 +3,101 @@
 
 #include "byte_stream.hh"
 
+#include <array>
 #include <cstdint>
+#include <list>
 #include <map>
-#include <queue>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 //! \brief A class that assembles a series of excerpts from a byte stream (possibly out of order,
 //! possibly overlapping) into an in-order byte stream.
 class StreamReassembler {
+  public:
+    //! How the reassembler holds bytes that arrived ahead of the next expected index
+    enum class Storage {
+        Map,  //!< a std::map of disjoint substrings; memory proportional to what is held
+        Ring  //!< a preallocated ring of `capacity` bytes plus a presence bitmap; no allocation after construction
+    };
+
   private:
     // Your code here -- add private members as necessary.
 
     ByteStream _output;  //!< The reassembled in-order byte stream
     size_t _capacity;    //!< The maximum number of bytes
-    std::map<size_t, std::string> data_container;
-    std::priority_queue<int, std::vector<int>, std::greater<int>> index_queue;
-    size_t next_expected_index;
-    size_t end_index;
+    Storage storage;
+
+    //! Out-of-order substrings keyed by stream index (Storage::Map only). The stored
+    //! intervals are disjoint, and all of them start after `next_expected_index`.
+    //! Each is a Buffer, so a substring pushed as a Buffer is held (and trimmed) without copying.
+    std::map<uint64_t, Buffer> data_container;
+
+    //! Byte for stream index `i` lives at `ring_buffer[i % _capacity]` (Storage::Ring only)
+    std::vector<char> ring_buffer;
+    //! Bit `i % 64` of word `i / 64` is set if ring slot `i` holds an unassembled byte
+    std::vector<uint64_t> ring_bitmap;
+    //! Reserved at construction and reused to hand contiguous ring bytes to the output
+    std::string ring_scratch;
+
+    //! The most held ranges whose recency Storage::Ring remembers (as many SACK blocks as fit in a TCP header)
+    static constexpr size_t RING_RECENT_RANGES = 4;
+    //! A stream index in each of the most recently pushed-to held ranges, most recent first (Storage::Ring
+    //! only). The ranges themselves are read off the presence bitmap, and an index below
+    //! `next_expected_index` belongs to a range that has since been assembled.
+    std::array<uint64_t, RING_RECENT_RANGES> ring_recent;
+    size_t ring_recent_count;
+
+    //! Maximal runs [start, end) of held stream indices, most recently pushed-to first (Storage::Map only)
+    std::list<std::pair<uint64_t, uint64_t>> recent_ranges;
+    //! The same runs keyed by start index
+    std::map<uint64_t, std::list<std::pair<uint64_t, uint64_t>>::iterator> ranges_by_start;
+
+    uint64_t next_expected_index;
+    uint64_t end_index;
     bool ended;
-    size_t current_unassembled_bytes;
+    size_t current_unassembled_bytes;  //!< number of bytes held, kept up to date on every change
+
+    //! Record `eof`, and return the [start, end) of stream indices of a pushed substring
+    //! that are both new and inside the window
+    std::pair<uint64_t, uint64_t> acceptable_range(const uint64_t index, const size_t size, const bool eof);
+
+    //! Store `data` (which begins at stream index `start`), skipping bytes already held
+    void insert_into_map(Buffer data, const uint64_t start);
+    void insert_into_ring(const std::string_view data, const uint64_t start);
+
+    //! Record that [start, end) is held, merging it into the held range it belongs to and
+    //! making that range the most recent
+    void touch_range(uint64_t start, uint64_t end);
+    void touch_ring_range(const uint64_t start);
+
+    //! \returns the maximal run [start, end) of held stream indices containing `index` (Storage::Ring only)
+    std::pair<uint64_t, uint64_t> ring_run(const uint64_t index) const;
+
+    //! Write every byte that is now contiguous with the output into it, and end the
+    //! output once the last byte of the stream has been written
+    void flush();
+    void flush_map();
+    void flush_ring();
+
+    //! \name Presence bitmap helpers; `slot` + `count` must not run past the end of the ring
+    //!@{
+    size_t mark_present(const size_t slot, const size_t count);  //!< \returns the number of newly-set bits
+    void mark_absent(const size_t slot, const size_t count);
+    size_t present_run(const size_t slot, const size_t limit) const;  //!< \returns the run of set bits at `slot`
+    size_t present_run_back(const size_t slot, const size_t limit) const;  //!< \returns the run ending before it
+    //!@}
 
   public:
     //! \brief Construct a `StreamReassembler` that will store up to `capacity` bytes.
     //! \note This capacity limits both the bytes that have been reassembled,
     //! and those that have not yet been reassembled.
-    StreamReassembler(const size_t capacity);
+    //! \param output_storage how the output stream holds reassembled bytes; with Storage::Map and
+    //!        ByteStream::Storage::Chunked, substrings pushed as Buffers reach the reader uncopied
+    StreamReassembler(const size_t capacity,
+                      const Storage storage_mode = Storage::Map,
+                      const ByteStream::Storage output_storage = ByteStream::Storage::Ring);
 
     //! \brief Receive a substring and write any newly contiguous bytes into the stream.
     //!
@@ -40,6 +109,10 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Receive a substring held in a Buffer (e.g., a parsed segment's payload)
+    //! \note With Storage::Map the reassembler keeps a reference to `data` rather than a copy.
+    void push_substring(Buffer data, const uint64_t index, const bool eof);
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
@@ -52,6 +125,19 @@ class StreamReassembler {
     //! should only be counted once for the purpose of this function.
     size_t unassembled_bytes() const;
 
+    //! \brief The contiguous ranges of stream indices held beyond the next expected index
+    //! \details Each range is [first index, last index + 1), in absolute stream indices. The first
+    //! range contains the most recently pushed substring, and the rest follow in order of when
+    //! they were last pushed to (the order RFC 2018 wants for SACK blocks). Storage::Ring remembers
+    //! only the 4 most recent, and finds their extent by scanning the presence bitmap.
+    //! \param max_blocks the maximum number of ranges to return
+    //! \returns the `max_blocks` most recent ranges, in O(max_blocks) with Storage::Map
+    std::vector<std::pair<uint64_t, uint64_t>> held_ranges(const size_t max_blocks) const;
+
+    //! \brief Bytes allocated to hold the unassembled bytes (not counting the output stream): the ring and its
+    //! bitmap, or the strings behind the stored substrings (one that consecutive substrings share counted once)
+    size_t allocated_bytes() const;
+
     //! \brief Is the internal state empty (other than the output stream)?
     //! \returns `true` if no substrings are waiting to be assembled
     bool empty() const;
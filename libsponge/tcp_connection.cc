@@ -1,6 +1,8 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 // Dummy implementation of a TCP connection
 
@@ -20,21 +22,55 @@ size_t TCPConnection::unassembled_bytes() const { return _receiver.unassembled_b
 
 size_t TCPConnection::time_since_last_segment_received() const { return time_pass; }
 
+//! \param[in] capacity the receive capacity, in bytes
+uint8_t TCPConnection::window_shift(const size_t capacity) {
+    uint8_t shift = 0;
+    while (shift < TCPHeader::MAX_WINDOW_SCALE and (capacity >> shift) > numeric_limits<uint16_t>::max()) {
+        shift++;
+    }
+    return shift;
+}
+
+//! \param[in] syn whether the window is for a SYN segment
+uint16_t TCPConnection::_advertised_window(const bool syn) const {
+    const size_t window = _receiver.window_size() >> (_window_scaling and not syn ? _window_shift : 0);
+    return min<size_t>(window, numeric_limits<uint16_t>::max());
+}
+
 void TCPConnection::_send_outbound_segments() {
     while (not _sender.segments_out().empty()) {
+        TCPSegment new_seg = _sender.segments_out().front();
         WrappingInt32 receiver_ackno{0};
-        size_t receiver_win_size{0};
+        uint16_t receiver_win_size{0};
         bool ack_flag = false;
         if (_receiver.ackno().has_value()) {
             receiver_ackno = _receiver.ackno().value();
-            receiver_win_size = _receiver.window_size();
+            receiver_win_size = _advertised_window(new_seg.header().syn);
             ack_flag = true;
         }
 
-        TCPSegment new_seg = _sender.segments_out().front();
         new_seg.header().ackno = receiver_ackno;
         new_seg.header().win = receiver_win_size;
         new_seg.header().ack = ack_flag;
+        if (ack_flag) {
+            // whatever we send acknowledges all we've received
+            _unacked_bytes = 0;
+            _ack_delay_left_us.reset();
+            _advertised_window_bytes = _receiver.window_size();
+            _ack_owed = false;
+        }
+
+        // give our MSS and offer SACK and window scaling on our SYN (when answering a SYN, only what the
+        // peer offered), and once both sides have offered SACK, describe any out-of-order data we hold
+        if (new_seg.header().syn) {
+            new_seg.header().mss = _cfg.mss.value_or(TCPConfig::MAX_PAYLOAD_SIZE);
+            new_seg.header().sack_permitted = _cfg.sack and (not ack_flag or _peer_sack_permitted);
+            if (_cfg.window_scaling and (not ack_flag or _window_scaling)) {
+                new_seg.header().window_scale = _window_shift;
+            }
+        } else if (ack_flag and _cfg.sack and _peer_sack_permitted) {
+            new_seg.header().sack_blocks = _receiver.sack_blocks(TCPHeader::MAX_SACK_BLOCKS);
+        }
 
         if (timeout or destruct) {
             new_seg.header().rst = true;
@@ -44,51 +80,139 @@ void TCPConnection::_send_outbound_segments() {
         _sender.segments_out().pop();
         if (new_seg.header().fin) {
             outbound_fully_sent = true;
-            fin_sequence_no = new_seg.header().seqno;
+            _predicting_acks = false;
+            // the FIN occupies the sequence number after any SYN and payload it rides with
+            fin_sequence_no = new_seg.header().seqno + (new_seg.length_in_sequence_space() - 1);
         }
     }
 }
 
-void TCPConnection::segment_received(const TCPSegment &seg) {
+//! \param[in] prev is a segment received
+//! \param[in] next is the segment received right after it
+//! \returns whether `next` continues `prev`'s data with the same acknowledgment, so that the two can be
+//! processed as one
+static bool continues(const TCPSegment &prev, const TCPSegment &next) {
+    const TCPHeader &p = prev.header();
+    const TCPHeader &n = next.header();
+    return p.ack and n.ack and not(p.syn or p.rst or p.fin or p.urg or n.syn or n.rst or n.urg) and
+           prev.payload().size() > 0 and next.payload().size() > 0 and
+           n.seqno == p.seqno + static_cast<uint32_t>(prev.length_in_sequence_space()) and n.ackno == p.ackno and
+           n.win == p.win and n.sack_blocks == p.sack_blocks;
+}
+
+//! \param[in] segments is the first of the segments to process
+//! \param[in] count is how many there are: one, unless each continues the last (see continues())
+void TCPConnection::_receive(const TCPSegment *segments, const size_t count) {
+    const TCPSegment &first = segments[0];
+    const TCPSegment &last = segments[count - 1];
+
     // check RST flag
-    if (seg.header().rst) {
+    if (first.header().rst) {
         _sender.stream_in().set_error();
         _receiver.stream_out().set_error();
         // kill connection
         kill_connection = true;
-    } else {
-        _receiver.segment_received(seg);
+        return;
+    }
 
-        if (seg.header().ack) {
-            if (_sender.next_seqno_absolute() == 0) {
-                return;
-            }
+    if (first.header().syn) {
+        // without the option, assume the peer takes segments as large as ours (rather than RFC 9293's 536)
+        if (first.header().mss.has_value()) {
+            _sender.set_peer_mss(first.header().mss.value());
+        }
+        _peer_sack_permitted = first.header().sack_permitted;
+        _window_scaling = _cfg.window_scaling and first.header().window_scale.has_value();
+        if (_window_scaling) {
+            _peer_window_shift = min(first.header().window_scale.value(), TCPHeader::MAX_WINDOW_SCALE);
+        }
+    }
+    const optional<WrappingInt32> ackno_before = _receiver.ackno();
+    const size_t unassembled_before = _receiver.unassembled_bytes();
+    size_t length = 0, payload = 0, largest_payload = 0;
+    for (size_t i = 0; i < count; i++) {
+        _receiver.segment_received(segments[i]);
+        length += segments[i].length_in_sequence_space();
+        payload += segments[i].payload().size();
+        largest_payload = max(largest_payload, segments[i].payload().size());
+    }
 
-            _sender.ack_received(seg.header().ackno, seg.header().win);
+    // the segments all carry the same acknowledgment, so the sender hears it once
+    if (last.header().ack) {
+        if (_sender.next_seqno_absolute() == 0) {
+            return;
+        }
 
-            if (outbound_fully_sent and _receiver.ackno().has_value() and seg.header().ackno - 1 == fin_sequence_no) {
-                outbound_fully_ack = true;
-            }
+        if (_cfg.sack and not last.header().sack_blocks.empty()) {
+            _sender.sack_received(last.header().sack_blocks);
+        }
+        const size_t window = size_t{last.header().win}
+                              << (_window_scaling and not last.header().syn ? _peer_window_shift : 0);
+        _sender.ack_received(last.header().ackno, window, length > 0);
+
+        if (outbound_fully_sent and _receiver.ackno().has_value() and last.header().ackno - 1 == fin_sequence_no) {
+            outbound_fully_ack = true;
+        }
+    }
+
+    if (length > 0) {
+        // if the incoming segments occupied any sequence numbers,
+        // the TCPConnection makes sure that at least one segment is sent in reply,
+        // to reflect an update in the ackno and window size.
+        if (not connect_called) {
+            connect();
+            return;
         }
 
-        if (seg.length_in_sequence_space() > 0) {
-            // if the incoming segment occupied any sequence numbers,
-            // the TCPConnection makes sure that at least one segment is sent in reply,
-            // to reflect an update in the ackno and window size.
-            if (not connect_called) {
-                connect();
-            } else {
+        // ACK at once data that's out of order or fills a hole (so the sender learns of the loss, or its
+        // repair, without waiting), and a FIN (so the peer can finish closing); out-of-order data gets a
+        // duplicate ACK per segment, as if received one at a time, so the sender still counts enough to
+        // retransmit fast
+        const bool in_order = ackno_before.has_value() and _receiver.ackno().has_value() and
+                              _receiver.ackno().value() - ackno_before.value() == static_cast<int32_t>(length);
+        if (not in_order or last.header().fin or unassembled_before > 0 or _receiver.unassembled_bytes() > 0) {
+            for (size_t i = 0; i < (in_order ? 1 : count); i++) {
                 _sender.send_empty_segment();
             }
+            _send_outbound_segments();
+        } else {
+            _in_order_data_received(payload, largest_payload);
         }
+    }
 
-        if (_receiver.ackno().has_value() and (seg.length_in_sequence_space() == 0) and
-            seg.header().seqno == _receiver.ackno().value() - 1) {
-            _sender.send_empty_segment();
-        }
+    if (_receiver.ackno().has_value() and length == 0 and last.header().seqno == _receiver.ackno().value() - 1) {
+        _sender.send_empty_segment();
+        _send_outbound_segments();
+    }
+}
+
+//! \param[in] payload is the number of bytes that arrived
+//! \param[in] largest_payload is the largest payload of the segments they arrived in
+void TCPConnection::_in_order_data_received(const size_t payload, const size_t largest_payload) {
+    if (_cfg.ack_delay == 0) {
+        _ack_owed = true;
+        return;
+    }
+    // with delayed ACKs, every second full-sized segment
+    _unacked_bytes += payload;
+    _largest_payload = max(_largest_payload, largest_payload);
+    if (_unacked_bytes >= 2 * _largest_payload) {
+        _ack_owed = true;
+    } else if (not _ack_delay_left_us.has_value()) {
+        _ack_delay_left_us = uint64_t{_cfg.ack_delay} * 1000;
     }
+}
 
+void TCPConnection::_send_ack_owed() {
+    // an ACK owed goes out on its own, unless (with delayed ACKs) data the sender has queued can carry it
+    if (_ack_owed and (_cfg.ack_delay == 0 or _sender.segments_out().empty())) {
+        _sender.send_empty_segment();
+    }
     _send_outbound_segments();
+    _ack_owed = false;
+}
+
+void TCPConnection::_finish_receiving() {
+    _send_ack_owed();
 
     if (inbound_stream().input_ended()) {
         inbound_end = true;
@@ -98,9 +222,110 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         }
     }
 
+    _predict();
     time_pass = 0;
 }
 
+void TCPConnection::_predict() {
+    // both SYNs acknowledged; then data can come next until the peer's FIN (as long as nothing is out of
+    // order), and ACKs of new data until ours
+    const optional<WrappingInt32> ackno = _receiver.ackno();
+    const bool established = _cfg.header_prediction and ackno.has_value() and
+                             _sender.next_seqno_absolute() > _sender.bytes_in_flight() and active();
+    _predicting_data = established and not _receiver.stream_out().input_ended() and _receiver.unassembled_bytes() == 0;
+    _predicting_acks = established and not outbound_fully_sent;
+    if (established) {
+        _predicted_seqno = ackno.value();
+        _predicted_ackno = _sender.unacked_seqno();
+        _predicted_window = _sender.peer_window();
+    }
+}
+
+//! \param[in] seg is the segment received
+//! \returns whether `seg` was as predicted, and has been processed
+bool TCPConnection::_fast_path(const TCPSegment &seg) {
+    const TCPHeader &header = seg.header();
+    if (not(_predicting_data or _predicting_acks) or not header.ack or header.syn or header.fin or header.rst or
+        header.urg or header.seqno != _predicted_seqno or not header.sack_blocks.empty()) {
+        return false;
+    }
+
+    const size_t payload = seg.payload().size();
+    const size_t window = size_t{header.win} << (_window_scaling ? _peer_window_shift : 0);
+    if (payload == 0) {
+        // a pure ACK for new data: only the sender has anything to do (and it takes any window the ACK
+        // carries, which shrinks as the peer's reader falls behind, so that needn't be predicted)
+        if (not _predicting_acks or header.ackno - _predicted_ackno <= 0 or header.ackno - _sender.next_seqno() > 0) {
+            return false;
+        }
+        _sender.ack_received(header.ackno, window);
+        _predicted_ackno = header.ackno;
+        _predicted_window = window;
+        _send_outbound_segments();
+    } else {
+        // the next data, acknowledging nothing new in the same window: only the receiver has anything
+        // to do (for the sender, the acknowledgment would change nothing)
+        if (not _predicting_data or header.ackno != _predicted_ackno or window != _predicted_window or
+            payload > _receiver.window_size()) {
+            return false;
+        }
+        _receiver.in_order_segment_received(seg);
+        if (_receiver.stream_out().input_ended()) {
+            // it filled the gap before a FIN that came early: that's ACKed at once
+            _sender.send_empty_segment();
+            _send_outbound_segments();
+            _finish_receiving();
+            return true;
+        }
+        _predicted_seqno = _predicted_seqno + static_cast<uint32_t>(payload);
+        _in_order_data_received(payload, payload);
+        _send_ack_owed();
+    }
+    time_pass = 0;
+    return true;
+}
+
+void TCPConnection::segment_received(const TCPSegment &seg) {
+    _segments_processed++;
+    if (_fast_path(seg)) {
+        _fast_path_hits++;
+        return;
+    }
+    _receive(&seg, 1);
+    _finish_receiving();
+}
+
+//! \param[in] segments are the segments received, in the order they arrived
+//! \details Each run of segments that continue one another is processed as one: the receiver takes
+//! their payloads one after the other (without copying them into one), and the sender hears their
+//! acknowledgment once. ACKs that can wait are owed until the end, so that the batch gets at most one.
+void TCPConnection::segments_received(const vector<TCPSegment> &segments) {
+    _segments_processed += segments.size();
+    size_t begin = 0;
+    while (begin < segments.size()) {
+        size_t end = begin + 1;
+        while (end < segments.size() and continues(segments[end - 1], segments[end])) {
+            end++;
+        }
+        _receive(&segments[begin], end - begin);
+        begin = end;
+    }
+    if (not segments.empty()) {
+        _finish_receiving();
+    }
+}
+
+bool TCPConnection::_window_update_due() const {
+    if (_cfg.ack_delay == 0 or not _receiver.ackno().has_value() or _receiver.stream_out().input_ended()) {
+        return false;
+    }
+    // when it has grown by the lesser of half the buffer and an MSS (RFC 1122 section 4.2.3.3),
+    // and at least doubled, so a steady reader doesn't send an update every time
+    const size_t window = _receiver.window_size();
+    const size_t threshold = min(_cfg.recv_capacity / 2, size_t{_cfg.mss.value_or(TCPConfig::MAX_PAYLOAD_SIZE)});
+    return window >= _advertised_window_bytes + threshold and window >= 2 * _advertised_window_bytes;
+}
+
 bool TCPConnection::active() const {
     // return true until TCP connection is total done
     // totally done: shut down cleanly  or it recieved a RST
@@ -122,14 +347,33 @@ size_t TCPConnection::write(const string &data) {
     return data_written;
 }
 
+//! \param[in] fd is the file descriptor to read outbound data from
+size_t TCPConnection::write_from(FileDescriptor &fd) {
+    size_t data_written = _sender.stream_in().write_from(fd, remaining_outbound_capacity());
+
+    _sender.fill_window();
+
+    // push to TCP connection_segments_out
+    _send_outbound_segments();
+    return data_written;
+}
+
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
-void TCPConnection::tick(const size_t ms_since_last_tick) {
+void TCPConnection::tick(const size_t ms_since_last_tick) { tick_us(uint64_t{ms_since_last_tick} * 1000); }
+
+//! \param[in] us_since_last_tick number of microseconds since the last call to this method (or to tick())
+void TCPConnection::tick_us(const uint64_t us_since_last_tick) {
+    _us_since_last_ms += us_since_last_tick;
+    const size_t ms_since_last_tick = _us_since_last_ms / 1000;
     time_pass += ms_since_last_tick;
-    _sender.tick(ms_since_last_tick);
+    _us_since_last_ms %= 1000;
+    _receiver.tick(ms_since_last_tick);
+    _sender.tick_us(us_since_last_tick);
 
     if (_sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS) {
         // abort the connection
         timeout = true;
+        _predicting_data = _predicting_acks = false;
 
         _sender.stream_in().set_error();
         _receiver.stream_out().set_error();
@@ -138,9 +382,44 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     if (inbound_end && outbound_end && time_pass >= 10 * _cfg.rt_timeout) {
         _linger_after_streams_finish = false;
     }
+
+    // send a held-back ACK once its delay is up, or as soon as the reader has opened the window
+    if (_ack_delay_left_us.has_value()) {
+        _ack_delay_left_us = _ack_delay_left_us.value() - min(_ack_delay_left_us.value(), us_since_last_tick);
+    }
+    if (active() and (_ack_delay_left_us == optional<uint64_t>{0} or _window_update_due())) {
+        _sender.send_empty_segment();
+    }
     _send_outbound_segments();
 }
 
+void TCPConnection::inbound_stream_read() {
+    if (active() and _window_update_due()) {
+        _sender.send_empty_segment();
+        _send_outbound_segments();
+    }
+}
+
+optional<uint64_t> TCPConnection::next_deadline_us() const {
+    if (not active()) {
+        return {};
+    }
+    if (_window_update_due()) {
+        return 0;  // an owner that read the stream without calling inbound_stream_read()
+    }
+    optional<uint64_t> ret = _sender.next_deadline_us();
+    if (_ack_delay_left_us.has_value()) {
+        ret = min(ret.value_or(_ack_delay_left_us.value()), _ack_delay_left_us.value());
+    }
+    if (inbound_end and outbound_end and _linger_after_streams_finish) {
+        const uint64_t linger_us = uint64_t{10} * _cfg.rt_timeout * 1000;
+        const uint64_t lingered_us = uint64_t{time_pass} * 1000 + _us_since_last_ms;
+        const uint64_t remaining_us = linger_us - min(linger_us, lingered_us);
+        ret = min(ret.value_or(remaining_us), remaining_us);
+    }
+    return ret;
+}
+
 void TCPConnection::end_input_stream() {
     // outbound
     _sender.stream_in().end_input();
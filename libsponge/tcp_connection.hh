@@ -6,12 +6,15 @@
 #include "tcp_sender.hh"
 #include "tcp_state.hh"
 
+#include <algorithm>
+#include <vector>
+
 //! \brief A complete endpoint of a TCP connection
 class TCPConnection {
   private:
     TCPConfig _cfg;
-    TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPReceiver _receiver{std::max(_cfg.recv_capacity, _cfg.recv_capacity_max), _cfg.recv_capacity};
+    TCPSender _sender{_cfg};
 
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
@@ -33,6 +36,67 @@ class TCPConnection {
     WrappingInt32 fin_sequence_no{0};
 
     size_t time_pass{0};
+    uint64_t _us_since_last_ms{0};  //!< microseconds tick_us() has seen beyond the last whole millisecond
+
+    //! the peer's SYN offered SACK; blocks are sent only then (and only if our config offers it too)
+    bool _peer_sack_permitted{false};
+
+    //! \name Window scaling ([RFC 7323](\ref rfc::rfc7323)), in effect once both SYNs have carried the option
+    //!@{
+    bool _window_scaling{false};
+    //! scales the windows we advertise, so that they can reach the most the receiver will buffer
+    uint8_t _window_shift{window_shift(std::max(_cfg.recv_capacity, _cfg.recv_capacity_max))};
+    uint8_t _peer_window_shift{0};  //!< scales the windows the peer advertises
+    //!@}
+
+    //! \name Delayed ACKs ([RFC 1122](\ref rfc::rfc1122) section 4.2.3.2), when _cfg.ack_delay is set
+    //!@{
+    size_t _unacked_bytes{0};                      //!< in-order payload received since we last sent an ACK
+    size_t _largest_payload{0};                    //!< the largest payload received: the peer's full segment
+    std::optional<uint64_t> _ack_delay_left_us{};  //!< time left to send an ACK for _unacked_bytes
+    size_t _advertised_window_bytes{0};            //!< the receive window our last ACK advertised
+    //!@}
+
+    bool _ack_owed{false};  //!< the segments being received call for an ACK, once they've all been processed
+
+    //! Process segments the peer sent, sending at once any ACK that can't wait for the rest of the batch
+    void _receive(const TCPSegment *segments, const size_t count);
+
+    //! In-order data arrived: owe an ACK for it, or (with delayed ACKs) perhaps hold the ACK back
+    void _in_order_data_received(const size_t payload, const size_t largest_payload);
+
+    //! Send any ACK owed, along with whatever else is queued
+    void _send_ack_owed();
+
+    //! Send what processing received segments left to send, including any ACK owed
+    void _finish_receiving();
+
+    //! \name Header prediction (Van Jacobson, 1988): in ESTABLISHED, the next segment most likely carries the
+    //! next in-order data or ACKs new data, and otherwise repeats the last segment's fields
+    //!@{
+    bool _predicting_data{false};       //!< whether the next in-order data can take the fast path
+    bool _predicting_acks{false};       //!< whether ACKs of new data can take the fast path
+    WrappingInt32 _predicted_seqno{0};  //!< the next in-order seqno (our ackno)
+    WrappingInt32 _predicted_ackno{0};  //!< the peer's latest ackno
+    size_t _predicted_window{0};        //!< the peer's latest window, scaled (checked only for data)
+    size_t _segments_processed{0};      //!< segments received
+    size_t _fast_path_hits{0};          //!< segments received that took the fast path
+
+    //! Update the predicted fields after processing segments the general way
+    void _predict();
+
+    //! \returns whether `seg` took the fast path: if it's as predicted, process it with a few compares
+    bool _fast_path(const TCPSegment &seg);
+    //!@}
+
+    //! \returns whether, with ACKs delayed, the reader has opened the window far enough to tell the peer now
+    bool _window_update_due() const;
+
+    //! \returns the smallest shift that lets `capacity` be advertised in a 16-bit window
+    static uint8_t window_shift(const size_t capacity);
+
+    //! \returns the window field to advertise, scaled unless `syn` is set (a SYN's window never is)
+    uint16_t _advertised_window(const bool syn) const;
 
     void _send_outbound_segments();
     bool connect_called{false};
@@ -48,6 +112,10 @@ class TCPConnection {
     //! \returns the number of bytes from `data` that were actually written.
     size_t write(const std::string &data);
 
+    //! \brief Read data from `fd` straight into the outbound byte stream, and send it over TCP if possible
+    //! \returns the number of bytes read from `fd` (at most remaining_outbound_capacity())
+    size_t write_from(FileDescriptor &fd);
+
     //! \returns the number of `bytes` that can be written right now.
     size_t remaining_outbound_capacity() const;
 
@@ -60,6 +128,7 @@ class TCPConnection {
 
     //! \brief The inbound byte stream received from the peer
     ByteStream &inbound_stream() { return _receiver.stream_out(); }
+    const ByteStream &inbound_stream() const { return _receiver.stream_out(); }
     //!@}
 
     //! \name Accessors used for testing
@@ -71,6 +140,16 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief Smoothed round-trip time in milliseconds (empty until an RTT has been measured)
+    std::optional<double> srtt() const { return _sender.srtt(); }
+    //! \brief Current retransmission timeout in milliseconds, including any exponential backoff
+    unsigned int rto() const { return _sender.rto(); }
+    //! \brief Receive memory committed, in bytes (see TCPReceiver::committed_bytes())
+    size_t committed_receive_bytes() const { return _receiver.committed_bytes(); }
+    //! \brief Number of segments received
+    size_t segments_processed() const { return _segments_processed; }
+    //! \brief Number of segments received that the header-prediction fast path handled
+    size_t fast_path_hits() const { return _fast_path_hits; }
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
@@ -81,9 +160,31 @@ class TCPConnection {
     //! Called when a new segment has been received from the network
     void segment_received(const TCPSegment &seg);
 
+    //! Called with segments received from the network together (e.g., all an adapter had ready in one
+    //! wakeup), to process runs of in-order data as one and answer the batch with at most one ACK
+    //! (besides the duplicate ACKs that out-of-order data calls for at once)
+    void segments_received(const std::vector<TCPSegment> &segments);
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! Called when time elapses, at the finer resolution a pacing sender needs
+    void tick_us(const uint64_t us_since_last_tick);
+
+    //! \returns microseconds until the sender's pacer releases a segment it's holding back, if it is;
+    //! the owner should call tick_us() by then
+    std::optional<uint64_t> pacing_delay_us() const { return _sender.pacing_delay_us(); }
+
+    //! Called after the application reads from inbound_stream(), so that (with delayed ACKs) the peer
+    //! hears at once if reading has reopened the window
+    void inbound_stream_read();
+
+    //! \returns microseconds until tick_us() next has something to do (a retransmission, the pacer's next
+    //! segment, a delayed ACK, a window update, or the end of lingering), or empty if nothing is pending
+    //! \note An owner can tick the connection only then, as long as it also ticks it up to the present
+    //! before passing it a segment (so the sender sees how long the segment took to be acknowledged)
+    std::optional<uint64_t> next_deadline_us() const;
+
     //! \brief TCPSegments that the TCPConnection has enqueued for transmission.
     //! \note The owner or operating system will dequeue these and
     //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
@@ -1,6 +1,7 @@
 #include "fd_adapter.hh"
 
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <utility>
 
@@ -45,12 +46,16 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
     return seg;
 }
 
-//! Serialize a TCP segment and send it as the payload of a UDP datagram.
+//! Serialize a TCP segment and send it as the payload of a UDP datagram (or of several, one per
+//! TCPSegment::offload_mss() bytes of payload, if the sender left it to the adapter to split up).
 //! \param[in] seg is the TCP segment to write
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
-    _sock.sendto(config().destination, seg.serialize(0));
+    const size_t max_payload = seg.offload_mss() > 0 ? seg.offload_mss() : numeric_limits<size_t>::max();
+    for (auto &payload : seg.serialize_segmented(max_payload)) {
+        _sock.sendto(config().destination, payload);
+    }
 }
 
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
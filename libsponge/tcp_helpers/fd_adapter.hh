@@ -38,6 +38,10 @@ class FdAdapterBase {
     //! \returns a mutable reference
     FdAdapterConfig &config_mut() { return _cfg; }
 
+    //! \brief The most TCP payload the adapter's datagrams can carry, if the path it sends them on limits it
+    //! \returns empty: a UDP datagram can carry a segment of any size a TCPConnection sends
+    std::optional<size_t> mss() const { return {}; }
+
     //! Called periodically when time elapses
     void tick(const size_t) {}
 };
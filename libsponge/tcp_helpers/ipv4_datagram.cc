@@ -27,15 +27,15 @@ BufferList IPv4Datagram::serialize() const {
 
     IPv4Header header_out = _header;
     header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
+    string header_serialized = header_out.serialize();
 
-    // calculate checksum -- taken over header only
+    // calculate checksum -- taken over header only -- and write it in place
     InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+    check.add(header_serialized);
+    NetUnparser::u16(header_serialized, IPv4Header::CKSUM_OFFSET, check.value());
 
     BufferList ret;
-    ret.append(header_out.serialize());
+    ret.append(move(header_serialized));
     ret.append(_payload);
     return ret;
 }
@@ -13,11 +13,46 @@ class TCPConfig {
   public:
     static constexpr size_t DEFAULT_CAPACITY = 64000;  //!< Default capacity
     static constexpr size_t MAX_PAYLOAD_SIZE = 1000;   //!< Conservative max payload size for real Internet
+    static constexpr size_t MAX_OFFLOAD_SIZE = 64000;  //!< Max payload of a segment for the adapter to split up
     static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
+    static constexpr unsigned DUP_ACK_THRESHOLD = 3;   //!< Duplicate ACKs that signal a lost segment (RFC 5681)
+    static constexpr uint16_t RTO_MIN_DFLT = 200;      //!< Default lower bound on an estimated timeout (as in Linux)
+    static constexpr unsigned RTO_MAX_DFLT = 60000;    //!< Default upper bound on the timeout (RFC 6298 2.5)
+    static constexpr uint16_t ACK_DELAY_DFLT = 40;     //!< A typical ack_delay, when turned on (as in Linux)
 
-    uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
+    //! Congestion control algorithms the sender can use (see CongestionController)
+    enum class CongestionControl {
+        None,     //!< send whatever the receiver's window allows
+        NewReno,  //!< RFC 5681 / RFC 6582
+        Cubic     //!< RFC 8312
+    };
+
+    //! Most payload per segment, to accept (offered on the SYN) and to send. If unset, TCPSpongeSocket uses
+    //! what its adapter's MTU allows, and a TCPConnection on its own uses MAX_PAYLOAD_SIZE.
+    std::optional<uint16_t> mss{};
+    uint16_t rt_timeout = TIMEOUT_DFLT;  //!< Initial value of the retransmission timeout, in milliseconds
+    //! Derive the timeout from measured RTTs (RFC 6298) after the first sample
+    bool adaptive_rto = false;
+    uint16_t rto_min = RTO_MIN_DFLT;  //!< Lower bound on the RTT-derived timeout, in milliseconds
+    unsigned rto_max = RTO_MAX_DFLT;  //!< Upper bound on the timeout, including backoff, in milliseconds
+    //! Limits the sender's bytes in flight
+    CongestionControl congestion_control = CongestionControl::None;
+    //! Spread new segments out at a rate derived from cwnd / SRTT, instead of sending bursts
+    bool pacing = false;
+    //! Offer selective acknowledgments (RFC 2018) on the SYN, and use them if the peer does too
+    bool sack = true;
+    //! Offer window scaling (RFC 7323) on the SYN, so windows can exceed 64 KiB
+    bool window_scaling = true;
+    //! Send segments of up to MAX_OFFLOAD_SIZE, which the adapter splits up
+    bool segmentation_offload = false;
+    //! Take a fast path for in-order data and pure ACKs in ESTABLISHED
+    bool header_prediction = true;
+    //! Hold back ACKs for up to this many ms, ACKing every second full segment (0: ACK each)
+    uint16_t ack_delay = 0;
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
+    //! If larger, auto-tune the receive window from recv_capacity up to this
+    size_t recv_capacity_max = 0;
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
     std::optional<WrappingInt32> fixed_isn{};
 };
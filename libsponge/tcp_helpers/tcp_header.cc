@@ -4,6 +4,112 @@
 
 using namespace std;
 
+//! TCP option kinds (see the IANA "TCP Option Kind Numbers" registry)
+enum : uint8_t {
+    OPTION_EOL = 0,             //!< end of option list
+    OPTION_NOP = 1,             //!< no-operation (padding)
+    OPTION_MSS = 2,             //!< [RFC 9293](\ref rfc::rfc9293) section 3.7.1
+    OPTION_WINDOW_SCALE = 3,    //!< [RFC 7323](\ref rfc::rfc7323)
+    OPTION_SACK_PERMITTED = 4,  //!< [RFC 2018](\ref rfc::rfc2018)
+    OPTION_SACK = 5             //!< [RFC 2018](\ref rfc::rfc2018)
+};
+
+//! Parse `length` bytes of options from `p` into `header`
+static void parse_options(TCPHeader &header, NetParser &p, size_t length) {
+    while (length > 0 and not p.error()) {
+        const uint8_t kind = p.u8();
+        length--;
+        if (kind == OPTION_EOL) {
+            p.remove_prefix(length);
+            return;
+        }
+        if (kind == OPTION_NOP) {
+            continue;
+        }
+
+        // every other option has a length byte, which counts the kind and itself
+        const uint8_t option_length = length > 0 ? p.u8() : 0;
+        if (option_length < 2 or option_length - 1U > length) {
+            p.set_error(ParseResult::HeaderTooShort);
+            return;
+        }
+        length -= option_length - 1;
+        const size_t value_length = option_length - 2;
+
+        switch (kind) {
+            case OPTION_MSS:
+                if (value_length != 2) {
+                    p.set_error(ParseResult::HeaderTooShort);
+                    return;
+                }
+                header.mss = p.u16();
+                break;
+            case OPTION_WINDOW_SCALE:
+                if (value_length != 1) {
+                    p.set_error(ParseResult::HeaderTooShort);
+                    return;
+                }
+                header.window_scale = p.u8();
+                break;
+            case OPTION_SACK_PERMITTED:
+                header.sack_permitted = true;
+                p.remove_prefix(value_length);
+                break;
+            case OPTION_SACK:
+                if (value_length % 8 != 0) {
+                    p.set_error(ParseResult::HeaderTooShort);
+                    return;
+                }
+                for (size_t i = 0; i < value_length / 8; i++) {
+                    const WrappingInt32 left{p.u32()};
+                    header.sack_blocks.emplace_back(left, WrappingInt32{p.u32()});
+                }
+                break;
+            default:
+                p.remove_prefix(value_length);
+        }
+    }
+}
+
+//! \returns the length of serialize_options(header), without building it
+static size_t options_length(const TCPHeader &header) {
+    return (header.mss.has_value() ? 4 : 0) + (header.window_scale.has_value() ? 4 : 0) +
+           (header.sack_permitted ? 4 : 0) + (header.sack_blocks.empty() ? 0 : 4 + 8 * header.sack_blocks.size());
+}
+
+//! \returns the options of `header`, each padded with NOPs to a multiple of four bytes
+static string serialize_options(const TCPHeader &header) {
+    string ret;
+    if (header.mss.has_value()) {
+        NetUnparser::u8(ret, OPTION_MSS);
+        NetUnparser::u8(ret, 4);
+        NetUnparser::u16(ret, header.mss.value());
+    }
+    if (header.window_scale.has_value()) {
+        NetUnparser::u8(ret, OPTION_NOP);
+        NetUnparser::u8(ret, OPTION_WINDOW_SCALE);
+        NetUnparser::u8(ret, 3);
+        NetUnparser::u8(ret, header.window_scale.value());
+    }
+    if (header.sack_permitted) {
+        NetUnparser::u8(ret, OPTION_NOP);
+        NetUnparser::u8(ret, OPTION_NOP);
+        NetUnparser::u8(ret, OPTION_SACK_PERMITTED);
+        NetUnparser::u8(ret, 2);
+    }
+    if (not header.sack_blocks.empty()) {
+        NetUnparser::u8(ret, OPTION_NOP);
+        NetUnparser::u8(ret, OPTION_NOP);
+        NetUnparser::u8(ret, OPTION_SACK);
+        NetUnparser::u8(ret, 2 + 8 * header.sack_blocks.size());
+        for (const auto &[left, right] : header.sack_blocks) {
+            NetUnparser::u32(ret, left.raw_value());
+            NetUnparser::u32(ret, right.raw_value());
+        }
+    }
+    return ret;
+}
+
 //! \param[in,out] p is a NetParser from which the TCP fields will be extracted
 //! \returns a ParseResult indicating success or the reason for failure
 //! \details It is important to check for (at least) the following potential errors
@@ -37,8 +143,11 @@ ParseResult TCPHeader::parse(NetParser &p) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
+    mss.reset();
+    window_scale.reset();
+    sack_permitted = false;
+    sack_blocks.clear();
+    parse_options(*this, p, doff * 4 - TCPHeader::LENGTH);
 
     if (p.error()) {
         return p.get_error();
@@ -48,20 +157,27 @@ ParseResult TCPHeader::parse(NetParser &p) {
 }
 
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
+//! \details The data offset written is `doff`, or more if that's too short for the options.
 string TCPHeader::serialize() const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
+    const string options = serialize_options(*this);
+    const size_t length = max<size_t>(4 * doff, LENGTH + options.size());
+    if (length > MAX_LENGTH) {
+        throw runtime_error("TCP options too long");
+    }
+
     string ret;
-    ret.reserve(4 * doff);
+    ret.reserve(length);
 
     NetUnparser::u16(ret, sport);              // source port
     NetUnparser::u16(ret, dport);              // destination port
     NetUnparser::u32(ret, seqno.raw_value());  // sequence number
     NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    NetUnparser::u8(ret, (length / 4) << 4);   // data offset
 
     const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
                          (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
@@ -72,11 +188,15 @@ string TCPHeader::serialize() const {
 
     NetUnparser::u16(ret, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    ret.append(options);
+    ret.resize(length);  // expand header to advertised size (zeros are end-of-option-list)
 
     return ret;
 }
 
+//! \details As serialize() writes it: `doff` words, or more if that's too short for the options.
+size_t TCPHeader::length() const { return max<size_t>(4 * doff, LENGTH + options_length(*this)); }
+
 //! \returns A string with the header's contents
 string TCPHeader::to_string() const {
     stringstream ss{};
@@ -89,14 +209,33 @@ string TCPHeader::to_string() const {
        << " fin: " << fin << '\n'
        << "TCP winsize: " << +win << '\n'
        << "TCP cksum: " << +cksum << '\n'
-       << "TCP uptr: " << +uptr << '\n';
+       << "TCP uptr: " << +uptr << '\n'
+       << "TCP MSS: " << (mss.has_value() ? std::to_string(mss.value()) : "none") << '\n'
+       << "TCP window scale: " << (window_scale.has_value() ? std::to_string(window_scale.value()) : "none") << '\n'
+       << "SACK permitted: " << sack_permitted << '\n';
+    for (const auto &[left, right] : sack_blocks) {
+        ss << "SACK block: " << left << "-" << right << '\n';
+    }
     return ss.str();
 }
 
 string TCPHeader::summary() const {
     stringstream ss{};
     ss << "Header(flags=" << (syn ? "S" : "") << (ack ? "A" : "") << (rst ? "R" : "") << (fin ? "F" : "")
-       << ",seqno=" << seqno << ",ack=" << ackno << ",win=" << win << ")";
+       << ",seqno=" << seqno << ",ack=" << ackno << ",win=" << win;
+    if (mss.has_value()) {
+        ss << ",mss=" << mss.value();
+    }
+    if (window_scale.has_value()) {
+        ss << ",wscale=" << +window_scale.value();
+    }
+    if (sack_permitted) {
+        ss << ",sackOK";
+    }
+    for (const auto &[left, right] : sack_blocks) {
+        ss << ",sack=" << left << "-" << right;
+    }
+    ss << ")";
     return ss.str();
 }
 
@@ -104,5 +243,6 @@ bool TCPHeader::operator==(const TCPHeader &other) const {
     // TODO(aozdemir) more complete check (right now we omit cksum, src, dst
     return seqno == other.seqno && ackno == other.ackno && doff == other.doff && urg == other.urg && ack == other.ack &&
            psh == other.psh && rst == other.rst && syn == other.syn && fin == other.fin && win == other.win &&
-           uptr == other.uptr;
+           uptr == other.uptr && mss == other.mss && window_scale == other.window_scale &&
+           sack_permitted == other.sack_permitted && sack_blocks == other.sack_blocks;
 }
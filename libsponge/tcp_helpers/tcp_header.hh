@@ -4,10 +4,21 @@
 #include "parser.hh"
 #include "wrapping_integers.hh"
 
+#include <optional>
+#include <utility>
+#include <vector>
+
 //! \brief [TCP](\ref rfc::rfc793) segment header
-//! \note TCP options are not supported
+//! \note Of the TCP options, only MSS ([RFC 9293](\ref rfc::rfc9293)), window scale ([RFC 7323](\ref rfc::rfc7323)),
+//! SACK-permitted and SACK ([RFC 2018](\ref rfc::rfc2018)) are understood; any others are skipped when parsing
 struct TCPHeader {
-    static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
+    static constexpr size_t LENGTH = 20;             //!< [TCP](\ref rfc::rfc793) header length, not including options
+    static constexpr size_t MAX_LENGTH = 60;         //!< header length with the most options the data offset allows
+    static constexpr size_t MAX_SACK_BLOCKS = 4;     //!< SACK blocks that fit in the option space
+    static constexpr uint8_t MAX_WINDOW_SCALE = 14;  //!< largest window shift RFC 7323 allows
+    static constexpr size_t SEQNO_OFFSET = 4;        //!< where the seqno sits in the serialized header
+    static constexpr size_t FLAGS_OFFSET = 13;       //!< where the flags byte sits in the serialized header
+    static constexpr size_t CKSUM_OFFSET = 16;       //!< where the checksum sits in the serialized header
 
     //! \struct TCPHeader
     //! ~~~{.txt}
@@ -50,12 +61,25 @@ struct TCPHeader {
     uint16_t uptr = 0;          //!< urgent pointer
     //!@}
 
+    //! \name TCP options
+    //!@{
+    std::optional<uint16_t> mss{};          //!< MSS option: the most payload the sender accepts (only on a SYN)
+    std::optional<uint8_t> window_scale{};  //!< window scale option: the sender's window shift (only on a SYN)
+    bool sack_permitted = false;            //!< SACK-permitted option (only meaningful on a SYN)
+
+    //! SACK option: blocks of received data [left edge, right edge) beyond the ackno
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> sack_blocks{};
+    //!@}
+
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! Length of the serialized header, options included, in bytes
+    size_t length() const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
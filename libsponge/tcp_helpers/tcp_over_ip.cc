@@ -4,7 +4,9 @@
 #include "ipv4_header.hh"
 #include "parser.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <limits>
 #include <stdexcept>
 #include <unistd.h>
 #include <utility>
@@ -81,10 +83,44 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
     InternetDatagram ip_dgram;
     ip_dgram.header().src = config().source.ipv4_numeric();
     ip_dgram.header().dst = config().destination.ipv4_numeric();
-    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().length() + seg.payload().size();
 
     // set payload, calculating TCP checksum using information from IP header
     ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
 
     return ip_dgram;
 }
+
+//! Takes a TCP segment, sets port numbers as necessary, and splits it into IPv4 datagrams that
+//! each carry at most TCPSegment::offload_mss() bytes of its payload, and fit in the MTU (see
+//! TCPSegment::serialize_segmented)
+//! \param[in] seg is the TCP segment to convert
+vector<InternetDatagram> TCPOverIPv4Adapter::wrap_tcp_in_ip_segmented(TCPSegment &seg) {
+    // set the port numbers in the TCP segment
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+
+    // whatever the sender sized the payload for, the options (e.g. SACK blocks) come out of the MTU too
+    const size_t headers_length = IPv4Header::LENGTH + seg.header().length();
+    const size_t max_payload = min(seg.offload_mss() > 0 ? seg.offload_mss() : numeric_limits<size_t>::max(),
+                                   _mtu > headers_length ? _mtu - headers_length : 1);
+
+    // every datagram has the same header but for its length
+    IPv4Header header;
+    header.src = config().source.ipv4_numeric();
+    header.dst = config().destination.ipv4_numeric();
+
+    vector<InternetDatagram> ret;
+    const auto tcp_segments = seg.serialize_segmented(max_payload, [&](const size_t tcp_length) {
+        header.len = header.hlen * 4 + tcp_length;
+        return header.pseudo_cksum();
+    });
+    for (const auto &tcp_segment : tcp_segments) {
+        InternetDatagram &ip_dgram = ret.emplace_back();
+        ip_dgram.header() = header;
+        ip_dgram.header().len = header.hlen * 4 + tcp_segment.size();
+        ip_dgram.payload() = tcp_segment;
+    }
+
+    return ret;
+}
@@ -7,13 +7,30 @@
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <vector>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    size_t _mtu{DEFAULT_MTU};  //!< the largest datagram to send
+
   public:
+    static constexpr size_t DEFAULT_MTU = 1500;  //!< Ethernet's MTU
+
+    //! \name The largest datagram to send (the path MTU)
+    //!@{
+    size_t mtu() const { return _mtu; }
+    void set_mtu(const size_t mtu) { _mtu = mtu; }
+    //!@}
+
+    //! \brief The most TCP payload that fits in a datagram (with a TCP header without options)
+    std::optional<size_t> mss() const { return _mtu - IPv4Header::LENGTH - TCPHeader::LENGTH; }
+
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    std::vector<InternetDatagram> wrap_tcp_in_ip_segmented(TCPSegment &seg);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
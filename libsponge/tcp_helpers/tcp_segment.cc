@@ -3,6 +3,7 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <variant>
 
 using namespace std;
@@ -30,16 +31,91 @@ size_t TCPSegment::length_in_sequence_space() const {
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
+    string header_serialized = header_out.serialize();
 
-    // calculate checksum -- taken over entire segment
+    // calculate checksum -- taken over entire segment -- and write it in place
     InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
+    check.add(header_serialized);
     check.add(_payload);
-    header_out.cksum = check.value();
+    NetUnparser::u16(header_serialized, TCPHeader::CKSUM_OFFSET, check.value());
 
     BufferList ret;
-    ret.append(header_out.serialize());
+    ret.append(move(header_serialized));
     ret.append(_payload);
 
     return ret;
 }
+
+//! \param[in] max_payload the most payload each of the segments may carry
+//! \param[in] datagram_layer_checksum gives the pseudo-checksum from the lower-layer protocol for
+//! a segment of the given length, header included (none if empty)
+//! \returns the serialized segments, in sequence order; just this one if it's small enough already
+vector<BufferList> TCPSegment::serialize_segmented(const size_t max_payload,
+                                                   const function<uint32_t(size_t)> &datagram_layer_checksum) const {
+    const auto pseudo_checksum = [&](const size_t length) -> uint32_t {
+        return datagram_layer_checksum ? datagram_layer_checksum(length) : 0;
+    };
+
+    // a SYN's options (and its own sequence number) belong to its first segment alone, so it
+    // doesn't share a template with the rest
+    TCPSegment rest = *this;
+    vector<BufferList> ret;
+    ret.reserve(_payload.size() / max_payload + 1);  // moving a BufferList allocates
+    if (_header.syn or _payload.size() <= max_payload) {
+        TCPSegment first = *this;
+        const size_t first_size = min(max_payload, _payload.size());
+        first.payload().remove_suffix(_payload.size() - first_size);
+        first.header().fin = _header.fin and first_size == _payload.size();
+        first.header().psh = _header.psh and first_size == _payload.size();
+        ret.push_back(first.serialize(pseudo_checksum(first.header().length() + first_size)));
+        if (first_size == _payload.size()) {
+            return ret;
+        }
+
+        rest.payload().remove_prefix(first_size);
+        rest.header().seqno = _header.seqno + first.length_in_sequence_space();
+        rest.header().syn = false;
+        rest.header().mss.reset();
+        rest.header().window_scale.reset();
+        rest.header().sack_permitted = false;
+    }
+
+    // the rest differ only in their seqno, flags and checksum: serialize the header once, with
+    // those zeroed, and patch each copy, working out its checksum from the template's
+    TCPHeader header_template = rest.header();
+    header_template.seqno = WrappingInt32{0};
+    header_template.fin = header_template.psh = false;
+    header_template.cksum = 0;
+    const string template_serialized = header_template.serialize();
+    InternetChecksum template_check;
+    template_check.add(template_serialized);
+    const uint16_t template_sum = ~template_check.value();
+
+    const size_t total = rest.payload().size();
+    for (size_t offset = 0; offset < total; offset += max_payload) {
+        const size_t size = min(max_payload, total - offset);
+        const bool last = offset + size == total;
+        const uint32_t seqno = (rest.header().seqno + offset).raw_value();
+        const uint8_t extra_flags = (last and _header.psh ? 0b0000'1000 : 0) | (last and _header.fin ? 0b0000'0001 : 0);
+
+        Buffer payload = rest.payload();
+        payload.remove_prefix(offset);
+        payload.remove_suffix(total - offset - size);
+
+        // the flags byte is the low half of its 16-bit word
+        InternetChecksum check(pseudo_checksum(template_serialized.size() + size) + template_sum + (seqno >> 16) +
+                               (seqno & 0xffff) + extra_flags);
+        check.add(payload);
+
+        string header = template_serialized;
+        NetUnparser::u32(header, TCPHeader::SEQNO_OFFSET, seqno);
+        NetUnparser::u8(header, TCPHeader::FLAGS_OFFSET, uint8_t(header[TCPHeader::FLAGS_OFFSET]) | extra_flags);
+        NetUnparser::u16(header, TCPHeader::CKSUM_OFFSET, check.value());
+
+        BufferList &segment = ret.emplace_back();
+        segment.append(move(header));
+        segment.append(payload);
+    }
+
+    return ret;
+}
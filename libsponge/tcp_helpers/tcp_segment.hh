@@ -5,12 +5,15 @@
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <functional>
+#include <vector>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
   private:
     TCPHeader _header{};
     Buffer _payload{};
+    size_t _offload_mss{0};  //!< with segmentation offload, the payload size to split into (0 to send it as is)
 
   public:
     //! \brief Parse the segment from a string
@@ -19,6 +22,12 @@ class TCPSegment {
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Serialize the segment as a series of segments carrying at most `max_payload` bytes each
+    //! \details Segmentation offload: the sender can hand over one large segment, and the adapter
+    //! splits it up into segments that fit in a datagram, as a NIC does with TSO.
+    std::vector<BufferList> serialize_segmented(
+        const size_t max_payload, const std::function<uint32_t(size_t)> &datagram_layer_checksum = {}) const;
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
@@ -26,6 +35,11 @@ class TCPSegment {
 
     const Buffer &payload() const { return _payload; }
     Buffer &payload() { return _payload; }
+
+    //! \brief With segmentation offload, the most payload each segment it's split into may carry
+    //! \note Not part of the segment on the wire: the adapter reads it to split the segment up (as a NIC does with TSO)
+    size_t offload_mss() const { return _offload_mss; }
+    size_t &offload_mss() { return _offload_mss; }
     //!@}
 
     //! \brief Segment's length in sequence space
@@ -5,9 +5,12 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <exception>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <sys/socket.h>
@@ -21,19 +24,23 @@ using namespace std;
 static constexpr size_t TCP_TICK_MS = 10;
 
 //! \param[in] condition is a function returning true if loop should continue
+//! \details The loop wakes up every TCP_TICK_MS (the adapter may have timers of its own), or sooner if
+//! the TCPConnection's next deadline comes first.
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
-    auto base_time = timestamp_ms();
+    auto base_time = timestamp_us();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        const chrono::microseconds timeout{
+            min<uint64_t>(TCP_TICK_MS * 1000, _tcp.value().next_deadline_us().value_or(TCP_TICK_MS * 1000))};
+        auto ret = _eventloop.wait_next_event(timeout);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
 
         if (_tcp.value().active()) {
-            const auto next_time = timestamp_ms();
-            _tcp.value().tick(next_time - base_time);
-            _datagram_adapter.tick(next_time - base_time);
+            const auto next_time = timestamp_us();
+            _tcp.value().tick_us(next_time - base_time);
+            _datagram_adapter.tick(next_time / 1000 - base_time / 1000);
             base_time = next_time;
         }
     }
@@ -52,7 +59,12 @@ TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> da
 
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
-    _tcp.emplace(config);
+    // unless told otherwise, accept and send segments as large as the path allows
+    TCPConfig tcp_config = config;
+    if (not tcp_config.mss.has_value() and _datagram_adapter.mss().has_value()) {
+        tcp_config.mss = min<size_t>(_datagram_adapter.mss().value(), numeric_limits<uint16_t>::max());
+    }
+    _tcp.emplace(tcp_config);
 
     // Set up the event loop
 
@@ -96,12 +108,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         _thread_data,
         Direction::In,
         [&] {
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
-            const auto len = data.size();
-            const auto amount_written = _tcp->write(move(data));
-            if (amount_written != len) {
-                throw runtime_error("TCPConnection::write() accepted less than advertised length");
-            }
+            _tcp->write_from(_thread_data);
 
             if (_thread_data.eof()) {
                 _tcp->end_input_stream();
@@ -128,10 +135,8 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
             // Write from the inbound_stream into
             // the pipe, handling the possibility of a partial
             // write (i.e., only pop what was actually written).
-            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
-            inbound.pop_output(bytes_written);
+            inbound.read_into(_thread_data, 65536);
+            _tcp->inbound_stream_read();
 
             if (inbound.eof() or inbound.error()) {
                 _thread_data.shutdown(SHUT_WR);
@@ -0,0 +1,274 @@
+#include "tcp_stack.hh"
+
+#include "ipv4_header.hh"
+#include "parser.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//! \param[in] other is the 4-tuple to compare with
+bool TCPStack::FourTuple::operator==(const FourTuple &other) const {
+    return local_address == other.local_address and local_port == other.local_port and
+           remote_address == other.remote_address and remote_port == other.remote_port;
+}
+
+//! \param[in] tuple is the 4-tuple to hash
+size_t TCPStack::FourTupleHash::operator()(const FourTuple &tuple) const {
+    // mix the fields (Fibonacci hashing), so that neighbouring ports and addresses land far apart
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15;
+    uint64_t hash = (uint64_t{tuple.remote_address} << 32 | uint64_t{tuple.remote_port} << 16 | tuple.local_port);
+    hash = (hash ^ tuple.local_address) * MULTIPLIER;
+    return hash ^ (hash >> 32);
+}
+
+//! \param[in] tuple names the new connection
+//! \param[in] cfg configures it
+TCPStack::Connection &TCPStack::_add(const FourTuple &tuple, const TCPConfig &cfg) {
+    // unless told otherwise, accept and send segments as large as the MTU allows
+    TCPOverIPv4Adapter adapter;
+    adapter.set_mtu(_mtu);
+    TCPConfig tcp_config = cfg;
+    if (not tcp_config.mss.has_value()) {
+        tcp_config.mss = min<size_t>(adapter.mss().value(), numeric_limits<uint16_t>::max());
+    }
+
+    const auto [it, added] = _connections.try_emplace(tuple, tcp_config);
+    if (not added) {
+        throw runtime_error("TCPStack: connection already exists");
+    }
+    Connection &connection = it->second;
+    connection.adapter = adapter;
+    connection.adapter.config_mut().source = {inet_ntoa({htobe32(tuple.local_address)}), tuple.local_port};
+    connection.adapter.config_mut().destination = {inet_ntoa({htobe32(tuple.remote_address)}), tuple.remote_port};
+    connection.last_tick = _wheel.now();
+    connection.timer = _wheel.add_timer([this, tuple] {
+        Connection &expired = _find(tuple);
+        _catch_up(expired);
+        _flush(tuple, expired);
+    });
+    return connection;
+}
+
+//! \param[in] tuple names the connection
+TCPStack::Connection &TCPStack::_find(const FourTuple &tuple) {
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        throw runtime_error("TCPStack: no such connection");
+    }
+    return it->second;
+}
+
+//! \param[in] connection is the connection to tick
+void TCPStack::_catch_up(Connection &connection) {
+    const uint64_t now = _wheel.now();
+    if (now > connection.last_tick) {
+        connection.tcp.tick(now - connection.last_tick);
+        connection.last_tick = now;
+    }
+}
+
+//! \param[in] tuple names the connection
+//! \param[in] connection is the connection
+void TCPStack::_flush(const FourTuple &tuple, Connection &connection) {
+    while (not connection.tcp.segments_out().empty()) {
+        for (auto &dgram : connection.adapter.wrap_tcp_in_ip_segmented(connection.tcp.segments_out().front())) {
+            _datagrams_out.push(move(dgram));
+        }
+        connection.tcp.segments_out().pop();
+    }
+
+    // once it's done, it stays only until the application has read what it received
+    if (not connection.tcp.active()) {
+        const ByteStream &inbound = connection.tcp.inbound_stream();
+        if (inbound.buffer_empty() or inbound.error()) {
+            _wheel.remove_timer(connection.timer);
+            _connections.erase(tuple);
+        } else {
+            _wheel.disarm(connection.timer);
+        }
+        return;
+    }
+
+    const auto deadline_us = connection.tcp.next_deadline_us();
+    if (deadline_us.has_value()) {
+        _wheel.arm(connection.timer, (deadline_us.value() + 999) / 1000);
+    } else {
+        _wheel.disarm(connection.timer);
+    }
+}
+
+//! \param[in] port is the port to listen on
+//! \param[in] cfg configures the connections accepted
+//! \param[in] backlog is the most connections to hold until they're accepted
+void TCPStack::listen(const uint16_t port, const TCPConfig &cfg, const size_t backlog) {
+    if (not _listeners.try_emplace(port, Listener{cfg, backlog}).second) {
+        throw runtime_error("TCPStack: already listening on port " + to_string(port));
+    }
+}
+
+//! \param[in] port is the listening port
+//! \returns the connection's 4-tuple, if there is one
+optional<TCPStack::FourTuple> TCPStack::accept(const uint16_t port) {
+    const auto listener = _listeners.find(port);
+    if (listener == _listeners.end()) {
+        throw runtime_error("TCPStack: not listening on port " + to_string(port));
+    }
+    // skip any connection reset before it was accepted
+    auto &pending = listener->second.pending;
+    while (not pending.empty()) {
+        const FourTuple tuple = pending.front();
+        pending.pop_front();
+        if (contains(tuple)) {
+            return tuple;
+        }
+    }
+    return {};
+}
+
+//! \param[in] cfg configures the connection
+//! \param[in] local is the local address and port
+//! \param[in] remote is the address and port to connect to
+//! \returns the new connection's 4-tuple
+TCPStack::FourTuple TCPStack::connect(const TCPConfig &cfg, const Address &local, const Address &remote) {
+    const FourTuple tuple{local.ipv4_numeric(), local.port(), remote.ipv4_numeric(), remote.port()};
+    Connection &connection = _add(tuple, cfg);
+    connection.tcp.connect();
+    _flush(tuple, connection);
+    return tuple;
+}
+
+//! \param[in] tuple names the connection
+//! \param[in] data is the data to write
+size_t TCPStack::write(const FourTuple &tuple, const string &data) {
+    Connection &connection = _find(tuple);
+    _catch_up(connection);
+    const size_t written = connection.tcp.write(data);
+    _flush(tuple, connection);
+    return written;
+}
+
+//! \param[in] tuple names the connection
+//! \param[in] len is the most to read
+//! \returns the bytes read
+string TCPStack::read(const FourTuple &tuple, const size_t len) {
+    Connection &connection = _find(tuple);
+    ByteStream &inbound = connection.tcp.inbound_stream();
+    string ret = inbound.read(min(len, inbound.buffer_size()));
+    _catch_up(connection);
+    connection.tcp.inbound_stream_read();
+    _flush(tuple, connection);
+    return ret;
+}
+
+//! \param[in] tuple names the connection
+void TCPStack::end_input_stream(const FourTuple &tuple) {
+    Connection &connection = _find(tuple);
+    _catch_up(connection);
+    connection.tcp.end_input_stream();
+    _flush(tuple, connection);
+}
+
+//! \param[in] tuple names the connection
+const TCPConnection &TCPStack::connection(const FourTuple &tuple) const {
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        throw runtime_error("TCPStack: no such connection");
+    }
+    return it->second.tcp;
+}
+
+//! \param[in] dgram is the datagram
+//! \param[out] seg is the TCP segment it carries
+//! \returns the 4-tuple of the segment's connection, if the datagram carries one
+static optional<TCPStack::FourTuple> parse_tcp(const InternetDatagram &dgram, TCPSegment &seg) {
+    if (dgram.header().proto != IPv4Header::PROTO_TCP or
+        seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError) {
+        return {};
+    }
+    return TCPStack::FourTuple{dgram.header().dst, seg.header().dport, dgram.header().src, seg.header().sport};
+}
+
+//! \param[in] tuple names the connection
+//! \param[in] first is the first segment for it
+//! \returns the connection, or nullptr if there is none (and `first` isn't a SYN that starts one)
+TCPStack::Connection *TCPStack::_receiving(const FourTuple &tuple, const TCPSegment &first) {
+    const auto it = _connections.find(tuple);
+    if (it != _connections.end()) {
+        return &it->second;
+    }
+
+    // a SYN for a listening port starts a connection; anything else for no connection is dropped
+    const auto listener = _listeners.find(tuple.local_port);
+    if (listener == _listeners.end() or not first.header().syn or first.header().ack or first.header().rst) {
+        return nullptr;
+    }
+    // beyond the backlog, drop the SYN (as Linux does) rather than refuse it: by the time the sender
+    // retries, the application may have accepted some (those reset meanwhile don't count)
+    auto &pending = listener->second.pending;
+    if (pending.size() >= listener->second.backlog) {
+        pending.erase(remove_if(pending.begin(), pending.end(), [&](const FourTuple &t) { return not contains(t); }),
+                      pending.end());
+        if (pending.size() >= listener->second.backlog) {
+            return nullptr;
+        }
+    }
+    Connection &connection = _add(tuple, listener->second.config);
+    pending.push_back(tuple);
+    return &connection;
+}
+
+//! \param[in] dgram is the datagram received
+void TCPStack::datagram_received(const InternetDatagram &dgram) {
+    TCPSegment seg;
+    const auto tuple = parse_tcp(dgram, seg);
+    if (not tuple.has_value()) {
+        return;
+    }
+    Connection *connection = _receiving(tuple.value(), seg);
+    if (connection == nullptr) {
+        return;
+    }
+    _catch_up(*connection);
+    connection->tcp.segment_received(seg);
+    _flush(tuple.value(), *connection);
+}
+
+//! \param[in] dgrams are the datagrams received, in the order they arrived
+//! \details Each run of consecutive segments for one connection is passed to
+//! TCPConnection::segments_received() together, so that it is processed, and ACKed, as one.
+void TCPStack::datagrams_received(const vector<InternetDatagram> &dgrams) {
+    FourTuple run_tuple{};
+    vector<TCPSegment> run;
+    const auto finish_run = [&] {
+        Connection *connection = run.empty() ? nullptr : _receiving(run_tuple, run.front());
+        if (connection != nullptr) {
+            _catch_up(*connection);
+            connection->tcp.segments_received(run);
+            _flush(run_tuple, *connection);
+        }
+        run.clear();
+    };
+
+    for (const auto &dgram : dgrams) {
+        TCPSegment seg;
+        const auto tuple = parse_tcp(dgram, seg);
+        if (not tuple.has_value()) {
+            continue;
+        }
+        if (not(tuple.value() == run_tuple)) {
+            finish_run();
+            run_tuple = tuple.value();
+        }
+        run.push_back(move(seg));
+    }
+    finish_run();
+}
+
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
+void TCPStack::tick(const size_t ms_since_last_tick) { _wheel.advance(ms_since_last_tick); }
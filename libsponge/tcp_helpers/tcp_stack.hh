@@ -0,0 +1,160 @@
+#ifndef SPONGE_LIBSPONGE_TCP_STACK_HH
+#define SPONGE_LIBSPONGE_TCP_STACK_HH
+
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_over_ip.hh"
+#include "timer_wheel.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Many TCP connections sharing one stream of IPv4 datagrams
+class TCPStack {
+  public:
+    //! Names a connection: its local and remote addresses and ports
+    struct FourTuple {
+        uint32_t local_address;
+        uint16_t local_port;
+        uint32_t remote_address;
+        uint16_t remote_port;
+
+        bool operator==(const FourTuple &other) const;
+    };
+
+  private:
+    struct FourTupleHash {
+        size_t operator()(const FourTuple &tuple) const;
+    };
+
+    //! A connection, with what the stack needs to carry its segments and keep its time
+    struct Connection {
+        TCPOverIPv4Adapter adapter;    //!< wraps its segments in datagrams addressed by its 4-tuple
+        TCPConnection tcp;             //!< the connection itself
+        TimerWheel::TimerId timer{0};  //!< armed for when it next needs a tick
+        uint64_t last_tick{0};         //!< wheel time it was last ticked
+
+        explicit Connection(const TCPConfig &cfg) : adapter(), tcp(cfg) {}
+    };
+
+    //! A port accepting connections
+    struct Listener {
+        TCPConfig config;
+        size_t backlog;                   //!< the most connections that may wait in `pending`
+        std::deque<FourTuple> pending{};  //!< connections its SYNs started, not yet accepted
+    };
+
+    size_t _mtu;
+    TimerWheel _wheel{};
+    std::unordered_map<FourTuple, Connection, FourTupleHash> _connections{};
+    std::unordered_map<uint16_t, Listener> _listeners{};
+
+    //! outbound queue of datagrams that the TCPStack wants sent
+    std::queue<InternetDatagram> _datagrams_out{};
+
+    //! Add a connection, configured by `cfg` (sending segments as large as the MTU allows, unless it says
+    //! otherwise), and set up its timer
+    Connection &_add(const FourTuple &tuple, const TCPConfig &cfg);
+
+    //! \returns the connection named by `tuple`, or throws if there is none
+    Connection &_find(const FourTuple &tuple);
+
+    //! \returns the connection a segment with this 4-tuple is for, accepting it if it's a SYN for a listening port
+    Connection *_receiving(const FourTuple &tuple, const TCPSegment &first);
+
+    //! Tick a connection up to the wheel's present
+    void _catch_up(Connection &connection);
+
+    //! Send what a connection has queued, then re-arm its timer, or remove it if it's done
+    void _flush(const FourTuple &tuple, Connection &connection);
+
+  public:
+    //! Connections a listening port holds for accept() unless listen() says otherwise (as Linux's SOMAXCONN)
+    static constexpr size_t DEFAULT_BACKLOG = 128;
+
+    //! Construct a stack that sends datagrams of up to `mtu` bytes
+    explicit TCPStack(const size_t mtu = TCPOverIPv4Adapter::DEFAULT_MTU) : _mtu(mtu) {}
+
+    //! \name Interface for applications
+    //!@{
+
+    //! \brief Accept connections on `port`, configured by `cfg`
+    //! \note Once `backlog` connections are waiting to be accepted, further SYNs to the port are dropped,
+    //! so that their senders retry them later.
+    void listen(const uint16_t port, const TCPConfig &cfg, const size_t backlog = DEFAULT_BACKLOG);
+
+    //! \brief Take a connection a SYN to `port` has started (empty if there's none)
+    std::optional<FourTuple> accept(const uint16_t port);
+
+    //! \brief Open a connection from `local` to `remote`
+    FourTuple connect(const TCPConfig &cfg, const Address &local, const Address &remote);
+
+    //! \brief Write data to a connection's outbound byte stream
+    //! \returns the number of bytes from `data` that were written
+    size_t write(const FourTuple &tuple, const std::string &data);
+
+    //! \brief Read up to `len` bytes from a connection's inbound byte stream
+    std::string read(const FourTuple &tuple, const size_t len);
+
+    //! \brief Shut down a connection's outbound byte stream
+    void end_input_stream(const FourTuple &tuple);
+
+    //! \brief Is there a connection with this 4-tuple?
+    //! \note A connection stays until it's inactive and its inbound stream has been read (or has failed).
+    bool contains(const FourTuple &tuple) const { return _connections.count(tuple) > 0; }
+
+    //! \brief The connection with this 4-tuple (see contains())
+    const TCPConnection &connection(const FourTuple &tuple) const;
+
+    //! \brief Number of connections
+    size_t size() const { return _connections.size(); }
+    //!@}
+
+    //! \name Methods for the owner or operating system to call
+    //!@{
+
+    //! \brief Pass a received datagram to the connection it is for (or, if it's a SYN, to a listener)
+    void datagram_received(const InternetDatagram &dgram);
+
+    //! \brief Pass datagrams received together (say, all that one wakeup could read) to their connections,
+    //! each connection's in one batch
+    void datagrams_received(const std::vector<InternetDatagram> &dgrams);
+
+    //! \brief Called periodically when time elapses: ticks the connections that have something to do
+    void tick(const size_t ms_since_last_tick);
+
+    //! \returns milliseconds until tick() next has something to do, or empty if no connection has
+    std::optional<uint64_t> next_expiry() const { return _wheel.next_expiry(); }
+
+    //! \brief Datagrams that the TCPStack has enqueued for transmission
+    std::queue<InternetDatagram> &datagrams_out() { return _datagrams_out; }
+    //!@}
+
+    //! \name construction and destruction
+    //! the connections' timers refer to the stack, so it can be neither copied nor moved
+    //!@{
+    ~TCPStack() = default;
+    TCPStack(const TCPStack &other) = delete;
+    TCPStack &operator=(const TCPStack &other) = delete;
+    TCPStack(TCPStack &&other) = delete;
+    TCPStack &operator=(TCPStack &&other) = delete;
+    //!@}
+};
+
+//! \class TCPStack
+//!
+//! The stack demultiplexes the datagrams it receives by their 4-tuple, in a hash table, and keeps time
+//! for its connections on a TimerWheel, so that each datagram, and each millisecond, costs the same
+//! however many connections there are. An owner reads datagrams from one device (say, a TunFD) and
+//! passes them to datagram_received() (or, as many as one wakeup could read, to datagrams_received()),
+//! writes out datagrams_out(), and calls tick() no later than next_expiry() says.
+
+#endif  // SPONGE_LIBSPONGE_TCP_STACK_HH
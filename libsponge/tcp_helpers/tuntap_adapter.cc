@@ -11,6 +11,8 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
                                                                const Address &ip_address,
                                                                const Address &next_hop)
     : _tap(move(tap)), _interface(eth_address, ip_address), _next_hop(next_hop) {
+    set_mtu(_tap.mtu());
+
     // Linux seems to ignore the first frame sent on a TAP device, so send a dummy frame to prime the pump :-(
     EthernetFrame dummy_frame;
     _tap.write(dummy_frame.serialize());
@@ -44,7 +46,9 @@ void TCPOverIPv4OverEthernetAdapter::tick(const size_t ms_since_last_tick) {
 
 //! \param[in] seg the TCPSegment to send
 void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
-    _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+    for (const auto &ip_dgram : wrap_tcp_in_ip_segmented(seg)) {
+        _interface.send_datagram(ip_dgram, _next_hop);
+    }
     send_pending();
 }
 
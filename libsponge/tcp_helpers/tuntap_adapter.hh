@@ -15,8 +15,8 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     TunFD _tun;
 
   public:
-    //! Construct from a TunFD
-    explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
+    //! Construct from a TunFD, sending datagrams as large as its MTU
+    explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) { set_mtu(_tun.mtu()); }
 
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
     std::optional<TCPSegment> read() {
@@ -28,7 +28,11 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    void write(TCPSegment &seg) {
+        for (const auto &ip_dgram : wrap_tcp_in_ip_segmented(seg)) {
+            _tun.write(ip_dgram.serialize());
+        }
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
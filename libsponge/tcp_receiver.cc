@@ -1,5 +1,6 @@
 #include "tcp_receiver.hh"
 
+#include <algorithm>
 #include <iostream>
 
 // Dummy implementation of a TCP receiver
@@ -9,14 +10,24 @@
 
 using namespace std;
 
+//! \returns `payload`, or a copy of it if sharing it would pin an allocation much larger than its bytes
+//! (as with a datagram read into a string sized for the largest possible read)
+static Buffer held_payload(const Buffer &payload) {
+    if (payload.storage_capacity() > TCPReceiver::MAX_PINNED_RATIO * payload.size()) {
+        return Buffer(payload.copy());
+    }
+    return payload;
+}
+
 void TCPReceiver::segment_received(const TCPSegment &seg) {
     // Set the Initial Sequence Number if necessary
-    const TCPHeader tcp_header = seg.header();
+    const TCPHeader &tcp_header = seg.header();
     WrappingInt32 seqno = tcp_header.seqno;
 
     if (not ackno().has_value() && not tcp_header.syn) {
         return;
     }
+    const uint64_t received_before = stream_out().bytes_written();
 
     if (not ackno().has_value() && tcp_header.syn) {
         isn = seqno;
@@ -24,11 +35,6 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     }
 
     // Push any data, or end-of-stream marker, to the StreamReassembler.
-    const Buffer tcp_payload = seg.payload();
-    Buffer data = tcp_payload.copy();
-    if (tcp_header.syn) {
-        data.remove_prefix(0);
-    }
     uint64_t absolute_seqno = unwrap(seqno, isn, stream_out().bytes_written());
     uint64_t stream_index = absolute_seqno - 1;
     if (tcp_header.syn) {
@@ -40,9 +46,73 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
 
     if (ackno().has_value() and last_seqno - ackno().value() > 0) {
         if (seqno - ackno().value() < 0 or abs(seqno - ackno().value()) < _capacity) {
-            _reassembler.push_substring(data.copy(), stream_index, tcp_header.fin);
+            // shares the parsed datagram's storage all the way to the reader, unless that would pin far more
+            _reassembler.push_substring(held_payload(seg.payload()), stream_index, tcp_header.fin);
         }
     }
+
+    if (stream_out().bytes_written() > received_before) {
+        _data_arrived();
+    }
+}
+
+//! \param[in] seg is the segment, with no flags, whose payload starts at the ackno and fits in the window
+void TCPReceiver::in_order_segment_received(const TCPSegment &seg) {
+    _reassembler.push_substring(held_payload(seg.payload()), stream_out().bytes_written(), false);
+    _data_arrived();
+}
+
+void TCPReceiver::_data_arrived() {
+    if (_initial_window < _capacity) {
+        _last_data_ms = _time_ms;
+        _sample_rtt();
+        _autotune();
+    }
+}
+
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
+void TCPReceiver::tick(const size_t ms_since_last_tick) {
+    _time_ms += ms_since_last_tick;
+    if (_initial_window < _capacity) {
+        _autotune();
+    }
+}
+
+void TCPReceiver::_sample_rtt() {
+    // from advertising a window to receiving its last byte takes a round trip if the sender fills the
+    // window (as it does whenever the window is what limits it), and longer if not
+    const uint64_t received = stream_out().bytes_written();
+    if (_rtt_target.has_value() and received >= _rtt_target.value()) {
+        const uint64_t sample = max<uint64_t>(_time_ms - _rtt_start_ms, 1);
+        _rtt_ms = _rtt_ms.has_value() ? (7 * _rtt_ms.value() + sample) / 8 : sample;
+        _rtt_target.reset();
+    }
+    if (not _rtt_target.has_value() and window_size() > 0) {
+        _rtt_target = received + window_size();
+        _rtt_start_ms = _time_ms;
+    }
+}
+
+void TCPReceiver::_autotune() {
+    // once the peer has gone quiet, fall back to the initial window, and measure afresh when it resumes
+    if (_time_ms - _last_data_ms >= IDLE_MS) {
+        _window_limit = _initial_window;
+        _rtt_ms.reset();
+        _rtt_target.reset();
+        _space_start_ms = _time_ms;
+        _space_start_read = stream_out().bytes_read();
+        return;
+    }
+
+    if (not _rtt_ms.has_value() or _time_ms - _space_start_ms < _rtt_ms.value()) {
+        return;
+    }
+    // leave room for twice what the reader consumed in the last round trip, so that a sender in slow
+    // start can keep doubling its rate (the window only grows here: shrinking it waits for idleness)
+    const uint64_t read = stream_out().bytes_read() - _space_start_read;
+    _window_limit = max<size_t>(_window_limit, min<uint64_t>(2 * read, _capacity));
+    _space_start_ms = _time_ms;
+    _space_start_read = stream_out().bytes_read();
 }
 
 optional<WrappingInt32> TCPReceiver::ackno() const {
@@ -58,4 +128,23 @@ optional<WrappingInt32> TCPReceiver::ackno() const {
     return {};
 }
 
-size_t TCPReceiver::window_size() const { return _capacity - stream_out().buffer_size(); }
+size_t TCPReceiver::window_size() const {
+    return _window_limit - min(_window_limit, stream_out().buffer_size());
+}
+
+size_t TCPReceiver::committed_bytes() const {
+    return _reassembler.allocated_bytes() + stream_out().allocated_bytes();
+}
+
+//! \param[in] max_blocks the most blocks to return
+vector<pair<WrappingInt32, WrappingInt32>> TCPReceiver::sack_blocks(const size_t max_blocks) const {
+    vector<pair<WrappingInt32, WrappingInt32>> ret;
+    if (not isn_set) {
+        return ret;
+    }
+    // stream index i has absolute seqno i + 1 (the SYN has absolute seqno 0)
+    for (const auto &[start, end] : _reassembler.held_ranges(max_blocks)) {
+        ret.emplace_back(wrap(start + 1, isn), wrap(end + 1, isn));
+    }
+    return ret;
+}
@@ -6,7 +6,11 @@
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <cstdint>
 #include <optional>
+#include <utility>
+#include <vector>
 
 //! \brief The "receiver" part of a TCP implementation.
 
@@ -14,7 +18,9 @@
 //! the acknowledgment number and window size to advertise back to the
 //! remote TCPSender.
 class TCPReceiver {
-    //! Our data structure for re-assembling bytes.
+    //! Our data structure for re-assembling bytes. Payloads are held as slices of the received
+    //! datagrams, both while out of order and in the inbound stream, so they are copied only when
+    //! the datagram's allocation is more than MAX_PINNED_RATIO times the payload.
     StreamReassembler _reassembler;
 
     //! The maximum number of bytes we'll store.
@@ -24,13 +30,43 @@ class TCPReceiver {
     bool isn_set;
     uint64_t checkpoint;
 
+    //! \name Receive window auto-tuning (dynamic right-sizing), when the capacity exceeds the initial window
+    //!@{
+    size_t _initial_window;                 //!< the window to start at, and to fall back to once idle
+    size_t _window_limit;                   //!< bytes the window is sized for now: at most _capacity
+    uint64_t _time_ms{0};                   //!< milliseconds tick() has seen
+    uint64_t _last_data_ms{0};              //!< when in-order data last arrived
+    std::optional<uint64_t> _rtt_ms{};      //!< smoothed time to receive a window's worth of data
+    std::optional<uint64_t> _rtt_target{};  //!< stream index whose arrival ends the current RTT sample
+    uint64_t _rtt_start_ms{0};              //!< when the current RTT sample began
+    uint64_t _space_start_ms{0};            //!< when the current round of reading began
+    uint64_t _space_start_read{0};          //!< bytes read when it began
+
+    //! Time the arrival of a window's worth of data: a round trip, when the window limits the sender
+    void _sample_rtt();
+
+    //! Each round trip, size the window for what the reader consumed; fall back once the peer is idle
+    void _autotune();
+
+    //! In-order data arrived: note it for auto-tuning
+    void _data_arrived();
+    //!@}
+
   public:
     //! \brief Construct a TCP receiver
     //!
     //! \param capacity the maximum number of bytes that the receiver will
     //!                 store in its buffers at any give time.
-    TCPReceiver(const size_t capacity)
-        : _reassembler(capacity), _capacity(capacity), isn(WrappingInt32(0)), isn_set(0), checkpoint(0) {}
+    //! \param initial_window if less than `capacity`, the window starts out sized for this many bytes, and
+    //!                       is tuned between the two as the reader's demand changes
+    TCPReceiver(const size_t capacity, const std::optional<size_t> initial_window = {})
+        : _reassembler(capacity, StreamReassembler::Storage::Map, ByteStream::Storage::Chunked)
+        , _capacity(capacity)
+        , isn(WrappingInt32(0))
+        , isn_set(0)
+        , checkpoint(0)
+        , _initial_window(std::min(initial_window.value_or(capacity), capacity))
+        , _window_limit(_initial_window) {}
 
     //! \name Accessors to provide feedback to the remote TCPSender
     //!@{
@@ -44,7 +80,8 @@ class TCPReceiver {
 
     //! \brief The window size that should be sent to the peer
     //!
-    //! Operationally: the capacity minus the number of bytes that the
+    //! Operationally: the capacity (or, with auto-tuning, the size the
+    //! window is tuned to) minus the number of bytes that the
     //! TCPReceiver is holding in its byte stream (those that have been
     //! reassembled, but not consumed).
     //!
@@ -53,6 +90,16 @@ class TCPReceiver {
     //! accepted by the receiver) and (b) the sequence number of the
     //! beginning of the window (the ackno).
     size_t window_size() const;
+
+    //! \brief Receive memory committed: the bytes allocated for the payloads held, in order or not
+    //! \details The buffers allocate only as data arrives and free it as it's read, so this follows what the
+    //! window lets in, and with auto-tuning what the reader needs. A payload held as a slice of its datagram
+    //! counts the whole datagram's allocation (no more than MAX_PINNED_RATIO times the payload when it arrived).
+    size_t committed_bytes() const;
+
+    //! \brief SACK blocks ([RFC 2018](\ref rfc::rfc2018)) describing the data held beyond the ackno
+    //! \returns up to `max_blocks` [left edge, right edge) seqno ranges, the most recently received first
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> sack_blocks(const size_t max_blocks) const;
     //!@}
 
     //! \brief number of bytes stored but not yet reassembled
@@ -61,6 +108,20 @@ class TCPReceiver {
     //! \brief handle an inbound segment
     void segment_received(const TCPSegment &seg);
 
+    //! \brief handle an inbound segment known to carry just the next in-order bytes, no more than the window
+    //! \note The fast path for segment_received(), for a caller that has checked all that (see TCPConnection)
+    void in_order_segment_received(const TCPSegment &seg);
+
+    //! \brief Let time pass (needed only to auto-tune the window)
+    void tick(const size_t ms_since_last_tick);
+
+    //! Idle this long, the window falls back to its initial size
+    static constexpr uint64_t IDLE_MS = 1000;
+
+    //! A payload is held as a slice of its datagram only while the datagram's allocation is at most this
+    //! many times the payload's size; otherwise it's copied, so that what's held stays near the capacity
+    static constexpr size_t MAX_PINNED_RATIO = 2;
+
     //! \name "Output" interface for the reader
     //!@{
     ByteStream &stream_out() { return _reassembler.stream_out(); }
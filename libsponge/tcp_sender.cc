@@ -3,7 +3,9 @@
 #include "tcp_config.hh"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <random>
 
 // Dummy implementation of a TCP sender
@@ -20,27 +22,121 @@ using namespace std;
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
 TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
-    : _isn(fixed_isn.value_or(WrappingInt32{random_device()()}))
-    , _initial_retransmission_timeout{retx_timeout}
-    , _stream(capacity)
-    , outstanding_segments() {}
+    : TCPSender([&] {
+        TCPConfig cfg;
+        cfg.send_capacity = capacity;
+        cfg.rt_timeout = retx_timeout;
+        cfg.fixed_isn = fixed_isn;
+        return cfg;
+    }()) {}
+
+//! \param[in] cfg supplies the stream capacity, the retransmission timeout settings and the ISN (if fixed)
+TCPSender::TCPSender(const TCPConfig &cfg)
+    : _isn(cfg.fixed_isn.value_or(WrappingInt32{random_device()()}))
+    , _initial_retransmission_timeout{cfg.rt_timeout}
+    , _adaptive_rto{cfg.adaptive_rto}
+    , _stream(cfg.send_capacity, ByteStream::Storage::Chunked)
+    , outstanding_segments()
+    , _rtt(cfg.rt_timeout, cfg.rto_min, cfg.rto_max)
+    , _mss(cfg.mss.value_or(TCPConfig::MAX_PAYLOAD_SIZE))
+    , _congestion_control(cfg.congestion_control)
+    , _congestion(CongestionController::make(_congestion_control, _mss))
+    , _segmentation_offload(cfg.segmentation_offload)
+    , _pacing(cfg.pacing)
+    , _timer(cfg.rt_timeout, cfg.adaptive_rto ? cfg.rto_max : numeric_limits<unsigned int>::max()) {}
+
+void RTTEstimator::add_sample(const size_t rtt) {
+    const double r = rtt;
+    if (not _srtt.has_value()) {
+        _srtt = r;
+        _rttvar = r / 2;
+    } else {
+        // beta = 1/4, alpha = 1/8; RTTVAR is updated with the old SRTT
+        _rttvar = 0.75 * _rttvar + 0.25 * abs(_srtt.value() - r);
+        _srtt = 0.875 * _srtt.value() + 0.125 * r;
+    }
+
+    const double rto = _srtt.value() + max(1.0, 4 * _rttvar);
+    _rto = static_cast<unsigned int>(clamp(ceil(rto), double(_rto_min), double(_rto_max)));
+}
 
 uint64_t TCPSender::bytes_in_flight() const {
     return _next_seqno - unwrap(current_ackno, _isn, stream_in().bytes_written());
 }
 
+optional<double> TCPSender::pacing_rate() const {
+    if (not _pacing) {
+        return {};
+    }
+    if (_congestion) {
+        return _congestion->pacing_rate(_rtt.srtt());
+    }
+    // without congestion control, spread the receiver's window over a round trip
+    if (not _rtt.srtt().has_value()) {
+        return {};
+    }
+    return double(current_win_size) / max(1.0, _rtt.srtt().value());
+}
+
+optional<uint64_t> TCPSender::pacing_delay_us() const {
+    if (not _pacing_held) {
+        return {};
+    }
+    return _next_send_us - min(_now_us, _next_send_us);
+}
+
+optional<uint64_t> TCPSender::next_deadline_us() const {
+    optional<uint64_t> ret = pacing_delay_us();
+    if (_timer.has_start()) {
+        // the timer counts the whole milliseconds tick_us() passes, the first of which is partly gone
+        const uint64_t rto_us = max<uint64_t>(uint64_t{_timer.current_rto()} * 1000, _now_us % 1000) - _now_us % 1000;
+        ret = min(ret.value_or(rto_us), rto_us);
+    }
+    return ret;
+}
+
+//! \param[in] bytes the sequence space the segment just released occupies
+void TCPSender::pace(const size_t bytes) {
+    const auto rate = pacing_rate();
+    if (not rate.has_value() or rate.value() <= 0) {
+        return;
+    }
+    // keep to the schedule, so that coarse ticks release what's come due since the last one
+    const uint64_t start = _next_send_us + PACING_MAX_LAG_US < _now_us ? _now_us : _next_send_us;
+    _next_send_us = start + static_cast<uint64_t>(double(bytes) * 1000 / rate.value());
+}
+
 void TCPSender::fill_window() {
-    size_t window_size_to_fill = 0;
-    if (current_win_size == 0) {
-        window_size_to_fill = 1 - bytes_in_flight();
-    } else {
-        window_size_to_fill = current_win_size - bytes_in_flight();
+    _pacing_held = false;
+
+    // a zero window is probed one byte at a time; otherwise the congestion window (in whole
+    // segments, so that its byte-by-byte growth doesn't send a trickle of tiny ones) may limit it further
+    size_t window = current_win_size == 0 ? 1 : current_win_size;
+    if (_congestion and current_win_size > 0) {
+        window = min(window, max(_congestion->cwnd() / _mss * _mss, _mss) + _recovery_inflation);
+    }
+    if (window <= bytes_in_flight()) {
+        return;
+    }
+    const size_t window_size_to_fill = window - bytes_in_flight();
+
+    // with segmentation offload, a segment carries no more than the pacer would release in a millisecond
+    // (in whole MSS), so that splitting it up doesn't make a burst the pacer would have spread out
+    size_t max_payload_size = _segmentation_offload ? max(TCPConfig::MAX_OFFLOAD_SIZE, _mss) : _mss;
+    const auto rate = pacing_rate();
+    if (max_payload_size > _mss and rate.has_value()) {
+        max_payload_size = clamp(static_cast<size_t>(rate.value()) / _mss * _mss, _mss, max_payload_size);
     }
 
     // read ByteStream
     size_t total_bytes_read = 0;
     while ((not syn_sent || stream_in().buffer_size() > 0 || (stream_in().eof() && not fin_sent)) &&
            (total_bytes_read < window_size_to_fill)) {
+        if (_pacing and _now_us < _next_send_us) {
+            _pacing_held = true;
+            break;
+        }
+
         // create a new segment
         TCPSegment new_seg;
 
@@ -57,15 +153,12 @@ void TCPSender::fill_window() {
             _next_seqno += 1;
         }
 
-        // read data
+        // slice the payload from the stream (without copying, unless it spans two writes)
         size_t stream_size = stream_in().buffer_size();
-        std::string data = stream_in().read(
-            std::min(std::min(window_size_to_fill - total_bytes_read, TCPConfig::MAX_PAYLOAD_SIZE), stream_size));
-
-        // set payload
-        new_seg.payload() = std::string(data);
-        total_bytes_read += data.size();
-        _next_seqno += data.size();
+        new_seg.payload() = stream_in().read_buffer(
+            std::min(std::min(window_size_to_fill - total_bytes_read, max_payload_size), stream_size));
+        total_bytes_read += new_seg.payload().size();
+        _next_seqno += new_seg.payload().size();
 
         // set fin bit
         if (stream_in().eof() && total_bytes_read < window_size_to_fill) {
@@ -75,31 +168,67 @@ void TCPSender::fill_window() {
             _next_seqno += 1;
         }
 
-        // push to _segments_out
-        _segments_out.push(new_seg);
-
-        // push to outstangind segments (because it has not been ack yet)
-        outstanding_segments[absolute_seqno] = new_seg;
-
         // check retransimission timer
         if (new_seg.length_in_sequence_space() > 0 && not _timer.has_start()) {
             _timer.start();
         }
+
+        // time this segment if no other is being timed
+        if (new_seg.length_in_sequence_space() > 0 && not _rtt_probe.has_value()) {
+            _rtt_probe.emplace(_next_seqno, _time_elapsed);
+        }
+
+        // keep it outstanding (because it has not been ack yet) and send it;
+        // both copies share the payload
+        outstanding_segments.push_back({absolute_seqno, new_seg, _time_elapsed, false, false});
+        if (new_seg.payload().size() > _mss) {
+            new_seg.offload_mss() = _mss;
+            _outstanding_offloaded = true;
+        }
+        if (_pacing) {
+            pace(new_seg.length_in_sequence_space());
+        }
+        _segments_out.push(std::move(new_seg));
     }
 }
 
 //! \param ackno The remote receiver's ackno (acknowledgment number)
-//! \param window_size The remote receiver's advertised window size
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+//! \param window_size The remote receiver's advertised window size, in bytes (after any window scaling)
+//! \param occupies_sequence_space Whether the segment also carried data, a SYN or a FIN (so it isn't a duplicate ACK)
+void TCPSender::ack_received(const WrappingInt32 ackno,
+                             const size_t window_size,
+                             const bool occupies_sequence_space) {
     // When the receiver gives the sender an ackno that acknowledges the successful receipt of new data
     if (ackno - next_seqno() > 0) {
         return;
     }
+
+    // a duplicate ACK acknowledges nothing new and leaves the window unchanged while data is outstanding
+    const bool duplicate = not occupies_sequence_space && ackno == current_ackno && window_size == current_win_size &&
+                           current_ackno != _isn && not outstanding_segments.empty();
+
+    // the timed segment has been acknowledged: take an RTT sample
+    if (_rtt_probe.has_value() && unwrap(ackno, _isn, _next_seqno) >= _rtt_probe->first) {
+        _rtt.add_sample(_time_elapsed - _rtt_probe->second);
+        _rtt_probe.reset();
+        if (_adaptive_rto) {
+            _timer.reset(_rtt.rto());
+        }
+    }
+
+    // the newly acknowledged bytes, not counting the SYN
+    const uint64_t previous_ackno = max(unwrap(current_ackno, _isn, _next_seqno), uint64_t{1});
+    const uint64_t new_ackno = unwrap(ackno, _isn, _next_seqno);
+    const size_t bytes_acked = new_ackno > previous_ackno ? new_ackno - previous_ackno : 0;
+    if (_congestion && bytes_acked > 0 && not _in_recovery) {
+        _congestion->on_ack(bytes_acked, _time_elapsed, _rtt.srtt());
+    }
+
     if (ackno - current_ackno > 0 && current_ackno != _isn) {
         _timer.stop();
-        _timer.reset(_initial_retransmission_timeout);
+        _timer.reset(_adaptive_rto ? _rtt.rto() : _initial_retransmission_timeout);
 
-        if (outstanding_segments.size() > 0) {
+        if (not outstanding_segments.empty()) {
             _timer.start();
         }
         consecutive_retransmission_count = 0;
@@ -111,22 +240,26 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     uint64_t absolute_ackno = unwrap(current_ackno, _isn, stream_in().bytes_written());
     current_win_size = window_size;
 
-    // scan outstanding segments, remove any that have been fully acknowledged
-    auto it = outstanding_segments.cbegin();
-    while (it != outstanding_segments.cend()) {
-        uint64_t segment_upper = it->first + it->second.payload().size();
-        if (it->second.header().fin) {
-            segment_upper += 1;
+    // pop the outstanding segments that have been fully acknowledged
+    while (not outstanding_segments.empty()) {
+        const auto &earliest = outstanding_segments.front();
+        if (earliest.seqno + earliest.segment.length_in_sequence_space() > absolute_ackno) {
+            break;
         }
-        if (segment_upper <= absolute_ackno) {
-            it = outstanding_segments.erase(it);
-        } else {
-            ++it;
+        outstanding_segments.pop_front();
+    }
+
+    if (duplicate) {
+        duplicate_ack_received();
+    } else if (new_ackno > previous_ackno) {
+        _duplicate_acks = 0;
+        if (_in_recovery) {
+            recovery_ack_received(bytes_acked);
         }
     }
 
     // When all outstanding data has been acknowledged, stop the retransmission timer
-    if (outstanding_segments.size() == 0) {
+    if (outstanding_segments.empty()) {
         _timer.stop();
     }
 
@@ -135,38 +268,39 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
-void TCPSender::tick(const size_t ms_since_last_tick) {
+void TCPSender::tick(const size_t ms_since_last_tick) { tick_us(uint64_t{ms_since_last_tick} * 1000); }
+
+//! \param[in] us_since_last_tick the number of microseconds since the last call to this method (or to tick())
+void TCPSender::tick_us(const uint64_t us_since_last_tick) {
+    // everything but the pacer runs on whole milliseconds
+    const size_t ms_since_last_tick = (_now_us + us_since_last_tick) / 1000 - _now_us / 1000;
+    _now_us += us_since_last_tick;
+    _time_elapsed += ms_since_last_tick;
+
     // If tick is called and the retransmission timer has expired:
     if (_timer.has_expired(ms_since_last_tick)) {
         // Retransmit the earliest (lowest sequence number)
         // segment that hasn’t been fully acknowledged by the TCP receiver.
-        uint64_t lower = unwrap(current_ackno, _isn, stream_in().bytes_written());
-        uint64_t earliest_seqno = unwrap(current_ackno + current_win_size, _isn, stream_in().bytes_written());
-        TCPSegment earliest;
-        bool find_earliest = false;
-
-        auto it = outstanding_segments.cbegin();
-        while (it != outstanding_segments.cend()) {
-            uint64_t segment_upper = it->first + it->second.payload().size();
-            if (segment_upper < lower) {
-                ++it;
-                continue;
-            } else {
-                // not fully acknowledged yet
-                // find the earliest segment
-                if (it->first <= earliest_seqno) {
-                    earliest_seqno = it->first;
-                    earliest = it->second;
-                    find_earliest = true;
-                }
-                ++it;
+        if (not outstanding_segments.empty()) {
+            // leave fast recovery, and don't start another for anything sent before now. The
+            // receiver may since have discarded what it SACKed, so forget that (RFC 2018 section 8).
+            _in_recovery = false;
+            _recovery_inflation = 0;
+            _duplicate_acks = 0;
+            _recover = _next_seqno;
+            _highest_sacked = 0;
+            for (auto &outstanding : outstanding_segments) {
+                outstanding.sacked = false;
+                outstanding.retransmitted = false;
             }
-        }
 
-        if (find_earliest) {
-            _segments_out.push(earliest);
+            retransmit_earliest();
+
             if (current_win_size > 0) {
                 consecutive_retransmission_count += 1;
+                if (_congestion) {
+                    _congestion->on_rto(bytes_in_flight(), _time_elapsed);
+                }
             }
         }
 
@@ -179,6 +313,159 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
     } else {
         _timer.update_rto(ms_since_last_tick);
     }
+
+    // release whatever the pacer was holding back, now that its time has come
+    if (_pacing_held and _now_us >= _next_send_us) {
+        fill_window();
+    }
+}
+
+void TCPSender::retransmit(OutstandingSegment &outstanding) {
+    _segments_out.push(outstanding.segment);
+    outstanding.sent_at = _time_elapsed;
+    outstanding.retransmitted = true;
+    _rtt_probe.reset();  // Karn's rule: an ack can't tell which transmission it's for
+}
+
+void TCPSender::fragment_outstanding() {
+    if (not _outstanding_offloaded) {
+        return;
+    }
+    _outstanding_offloaded = false;
+
+    const uint64_t absolute_ackno = unwrap(current_ackno, _isn, _next_seqno);
+    deque<OutstandingSegment> fragmented;
+    for (auto &outstanding : outstanding_segments) {
+        const size_t size = outstanding.segment.payload().size();
+        if (size <= _mss) {
+            fragmented.push_back(move(outstanding));
+            continue;
+        }
+
+        // each piece shares the payload, and keeps the SACK and retransmission state of the whole
+        uint64_t seqno = outstanding.seqno;
+        for (size_t offset = 0; offset < size; offset += _mss) {
+            const size_t piece_size = min(_mss, size - offset);
+            OutstandingSegment piece = outstanding;
+            piece.segment.offload_mss() = 0;
+            piece.seqno = seqno;
+            piece.segment.header().seqno = wrap(seqno, _isn);
+            piece.segment.header().syn = outstanding.segment.header().syn and offset == 0;
+            piece.segment.header().fin = outstanding.segment.header().fin and offset + piece_size == size;
+            piece.segment.payload().remove_prefix(offset);
+            piece.segment.payload().remove_suffix(size - offset - piece_size);
+
+            seqno += piece.segment.length_in_sequence_space();
+            if (seqno > absolute_ackno) {
+                fragmented.push_back(move(piece));
+            }
+        }
+    }
+    outstanding_segments = move(fragmented);
+}
+
+void TCPSender::retransmit_holes() {
+    fragment_outstanding();
+
+    // a hole may just be reordered rather than lost, so give it a quarter of an RTT (at least
+    // a tick) after it was sent before calling it lost, as RACK does (RFC 8985 section 6.2)
+    const auto reordering_window = static_cast<size_t>(max(1.0, _rtt.srtt().value_or(0) / 4));
+    // a retransmission can be lost too: if it's still a hole a round trip later, while data
+    // above it keeps arriving, send it again rather than wait for the timer (RFC 8985 section 6.1)
+    const auto round_trip = _rtt.srtt().has_value() ? static_cast<size_t>(ceil(_rtt.srtt().value())) : _rtt.rto();
+    for (auto &outstanding : outstanding_segments) {
+        if (outstanding.seqno >= _highest_sacked) {
+            break;
+        }
+        const size_t wait = reordering_window + (outstanding.retransmitted ? round_trip : 0);
+        if (not outstanding.sacked and _time_elapsed - outstanding.sent_at >= wait) {
+            retransmit(outstanding);
+        }
+    }
+}
+
+//! \param[in] blocks the [left edge, right edge) of each SACK block
+void TCPSender::sack_received(const vector<pair<WrappingInt32, WrappingInt32>> &blocks) {
+    fragment_outstanding();
+    for (const auto &[left, right] : blocks) {
+        const uint64_t start = unwrap(left, _isn, _next_seqno);
+        const uint64_t end = unwrap(right, _isn, _next_seqno);
+        if (start >= end or end > _next_seqno) {
+            continue;
+        }
+        _highest_sacked = max(_highest_sacked, end);
+
+        // mark the segments that lie entirely within the block
+        auto it = lower_bound(outstanding_segments.begin(),
+                              outstanding_segments.end(),
+                              start,
+                              [](const OutstandingSegment &outstanding, const uint64_t seqno) {
+                                  return outstanding.seqno < seqno;
+                              });
+        for (; it != outstanding_segments.end() and it->seqno + it->segment.length_in_sequence_space() <= end; ++it) {
+            it->sacked = true;
+        }
+    }
+}
+
+void TCPSender::duplicate_ack_received() {
+    _duplicate_acks += 1;
+    if (_in_recovery) {
+        // each further duplicate means another segment has left the network
+        _recovery_inflation += _mss;
+        retransmit_holes();
+        return;
+    }
+
+    // fast retransmit, unless the ACK only covers data sent before the last recovery began
+    // (then the duplicates may come from retransmissions that arrived twice; RFC 6582 section 4.1)
+    const uint64_t absolute_ackno = unwrap(current_ackno, _isn, _next_seqno);
+    if (_duplicate_acks != TCPConfig::DUP_ACK_THRESHOLD || absolute_ackno <= _recover) {
+        return;
+    }
+    if (_congestion) {
+        _congestion->on_loss(bytes_in_flight(), _time_elapsed);
+    }
+    _in_recovery = true;
+    _recover = _next_seqno;
+    _recovery_inflation = TCPConfig::DUP_ACK_THRESHOLD * _mss;
+    for (auto &outstanding : outstanding_segments) {
+        outstanding.retransmitted = false;
+    }
+    retransmit_earliest();
+    retransmit_holes();
+    _timer.start();
+}
+
+//! \param[in] bytes_acked how far the ACK moved the ackno
+void TCPSender::recovery_ack_received(const size_t bytes_acked) {
+    if (next_seqno_absolute() - bytes_in_flight() >= _recover) {
+        // a full ACK: everything outstanding when the loss was detected has arrived
+        _in_recovery = false;
+        _recovery_inflation = 0;
+        return;
+    }
+
+    // a partial ACK: the segment after what it acknowledges was lost too. Resend it (with SACK
+    // information, resend whichever holes are due instead), and deflate the window by what was
+    // acked, less the segment that is being resent.
+    if (_highest_sacked > outstanding_segments.front().seqno) {
+        retransmit_holes();
+    } else {
+        retransmit_earliest();
+    }
+    _recovery_inflation -= min(_recovery_inflation, bytes_acked);
+    _recovery_inflation += _mss;
+}
+
+//! \param[in] peer_mss the MSS option on the peer's SYN
+void TCPSender::set_peer_mss(const size_t peer_mss) {
+    if (peer_mss == 0 or peer_mss >= _mss or _next_seqno > 1) {
+        return;
+    }
+    // the initial window and the unit the controller grows it in depend on the MSS
+    _mss = peer_mss;
+    _congestion = CongestionController::make(_congestion_control, _mss);
 }
 
 unsigned int TCPSender::consecutive_retransmissions() const { return consecutive_retransmission_count; }
@@ -2,24 +2,32 @@
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
 #include "byte_stream.hh"
+#include "congestion_controller.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <deque>
 #include <functional>
-#include <map>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <queue>
+#include <utility>
+#include <vector>
 
 class RetransimissionTimer {
   private:
     unsigned int _init_rto;
     unsigned int _rto;
+    unsigned int _max_rto;  //!< exponential backoff stops here
 
     bool _start;
 
   public:
-    RetransimissionTimer(unsigned int initial_timeout)
-        : _init_rto(initial_timeout), _rto(initial_timeout), _start(false){};
+    RetransimissionTimer(unsigned int initial_timeout,
+                         unsigned int max_timeout = std::numeric_limits<unsigned int>::max())
+        : _init_rto(initial_timeout), _rto(initial_timeout), _max_rto(max_timeout), _start(false){};
 
     bool has_start() const { return _start; };
     bool has_expired(size_t time_elapsed) const { return has_start() && time_elapsed >= _rto; }
@@ -30,7 +38,7 @@ class RetransimissionTimer {
     }
     void double_rto() {
         if (has_start()) {
-            _init_rto += _init_rto;
+            _init_rto = _init_rto > _max_rto / 2 ? std::max(_init_rto, _max_rto) : _init_rto + _init_rto;
         }
     }
     void start() {
@@ -40,6 +48,35 @@ class RetransimissionTimer {
     void stop() { _start = false; }
     void reset(unsigned int reset_rto) { _init_rto = reset_rto; }
     unsigned int current_rto() const { return _rto; }
+    //! the timeout the timer runs for when (re)started, including any backoff
+    unsigned int timeout() const { return _init_rto; }
+};
+
+//! \brief Round-trip time estimator (RFC 6298)
+
+//! Keeps the smoothed round-trip time (SRTT) and its variation (RTTVAR) as in
+//! Jacobson/Karels, and derives RTO = SRTT + max(G, 4 * RTTVAR), clamped to [min, max].
+//! The clock granularity G is one millisecond, the resolution of TCPSender::tick().
+class RTTEstimator {
+  private:
+    std::optional<double> _srtt{};
+    double _rttvar{0};
+    unsigned int _rto;
+    unsigned int _rto_min;
+    unsigned int _rto_max;
+
+  public:
+    RTTEstimator(unsigned int initial_rto, unsigned int rto_min, unsigned int rto_max)
+        : _rto(initial_rto), _rto_min(rto_min), _rto_max(rto_max) {}
+
+    //! Fold in one measured round-trip time, in milliseconds
+    void add_sample(const size_t rtt);
+
+    //! \returns the smoothed round-trip time in milliseconds, or empty before the first sample
+    std::optional<double> srtt() const { return _srtt; }
+
+    //! \returns the retransmission timeout in milliseconds (the initial RTO before the first sample)
+    unsigned int rto() const { return _rto; }
 };
 
 //! \brief The "sender" part of a TCP implementation.
@@ -59,32 +96,122 @@ class TCPSender {
     //! retransmission timer for the connection
     unsigned int _initial_retransmission_timeout;
 
-    //! outgoing stream of bytes that have not yet been sent
+    //! derive the retransmission timeout from measured RTTs instead of always starting from the initial value
+    bool _adaptive_rto;
+
+    //! outgoing stream of bytes that have not yet been sent; chunked so that
+    //! segment payloads can be sliced from what the writer wrote
     ByteStream _stream;
 
     //! the (absolute) sequence number for the next byte to be sent
     uint64_t _next_seqno{0};
 
     WrappingInt32 current_ackno{_isn};
-    uint16_t current_win_size{1};
+    size_t current_win_size{1};
     bool syn_sent{false};
     bool fin_sent{false};
 
-    // outstanding segments
-    std::map<uint64_t, TCPSegment> outstanding_segments;
+    //! A segment sent but not yet fully acknowledged, and its place on the SACK scoreboard
+    struct OutstandingSegment {
+        uint64_t seqno;      //!< absolute seqno of its first byte
+        TCPSegment segment;  //!< shares its payload with the copy that was sent
+        size_t sent_at;      //!< when it was last (re)transmitted
+        bool sacked;         //!< the receiver has selectively acknowledged all of it
+        bool retransmitted;  //!< resent since the current recovery (or RTO) began
+    };
+
+    //! segments sent but not yet fully acknowledged, in seqno order (the order they are
+    //! sent in), so acks pop from the front and the earliest is always first
+    std::deque<OutstandingSegment> outstanding_segments;
+
+    //! absolute seqno just past the highest SACKed byte (0 if nothing outstanding is SACKed)
+    uint64_t _highest_sacked{0};
+
+    //! round-trip time estimate, sampled (one segment at a time) whenever the sender runs
+    RTTEstimator _rtt;
+
+    //! milliseconds since the sender was constructed
+    size_t _time_elapsed{0};
+
+    //! the segment being timed for an RTT sample: (absolute seqno just past its end, time sent).
+    //! Per Karn's rule this is dropped on any retransmission, so samples only come from segments sent once.
+    std::optional<std::pair<uint64_t, size_t>> _rtt_probe{};
+
+    //! the most payload a segment carries on the wire: our MSS, or the peer's if that's smaller
+    size_t _mss;
+
+    //! which congestion control algorithm to use (the controller is recreated if the MSS changes)
+    TCPConfig::CongestionControl _congestion_control;
+
+    //! limits the bytes in flight below the receiver's window (null if congestion control is off)
+    std::unique_ptr<CongestionController> _congestion;
+
+    //! \name Segmentation offload: new segments carry up to TCPConfig::MAX_OFFLOAD_SIZE, for the adapter to split
+    //!@{
+    bool _segmentation_offload;
+    bool _outstanding_offloaded{false};  //!< some outstanding segment carries more than an MSS
+    //!@}
+
+    //! Split the outstanding segments into MSS-sized pieces (dropping any acknowledged already), so that
+    //! loss recovery resends and SACKs mark them as the receiver saw them, not as the sender sent them
+    void fragment_outstanding();
+
+    //! \name Pacing: new segments go out one at a time, each after the previous one's size at pacing_rate()
+    //!@{
+    bool _pacing;               //!< pace new segments (retransmissions still go out at once)
+    uint64_t _now_us{0};        //!< microseconds since the sender was constructed (the pacer's clock)
+    uint64_t _next_send_us{0};  //!< when the pacer may release the next new segment
+    bool _pacing_held{false};   //!< fill_window() stopped early to wait until _next_send_us
+    //!@}
+
+    //! A schedule that's fallen further behind than this (because the sender was idle, or its
+    //! ticks are coarse) restarts from now, rather than releasing a burst to catch up
+    static constexpr uint64_t PACING_MAX_LAG_US = 1000;
+
+    //! Schedule the next release after `bytes` have been sent
+    void pace(const size_t bytes);
+
+    //! \name Fast retransmit and NewReno fast recovery (RFC 5681 and RFC 6582)
+    //!@{
+    size_t _duplicate_acks{0};      //!< duplicate ACKs received in a row
+    bool _in_recovery{false};       //!< between a fast retransmit and the ACK of everything sent before it
+    uint64_t _recover{0};           //!< highest absolute seqno sent when the last recovery (or RTO) began
+    size_t _recovery_inflation{0};  //!< bytes the congestion window is inflated by during recovery
+    //!@}
 
     // timer
-    RetransimissionTimer _timer{_initial_retransmission_timeout};
+    RetransimissionTimer _timer;
 
     // consecutive retransmission count
     size_t consecutive_retransmission_count{0};
 
+    //! Resend an outstanding segment
+    void retransmit(OutstandingSegment &outstanding);
+
+    //! Resend the earliest outstanding segment
+    void retransmit_earliest() {
+        fragment_outstanding();
+        retransmit(outstanding_segments.front());
+    }
+
+    //! Resend the segments below the highest SACKed byte that haven't been SACKed (nor resent in the last RTT)
+    void retransmit_holes();
+
+    //! Count a duplicate ACK, and fast retransmit on the third
+    void duplicate_ack_received();
+
+    //! New data was acknowledged while in fast recovery
+    void recovery_ack_received(const size_t bytes_acked);
+
   public:
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
               const std::optional<WrappingInt32> fixed_isn = {});
 
+    //! Initialize a TCPSender from the sender-side settings of a TCPConfig
+    explicit TCPSender(const TCPConfig &cfg);
+
     //! \name "Input" interface for the writer
     //!@{
     ByteStream &stream_in() { return _stream; }
@@ -94,8 +221,18 @@ class TCPSender {
     //! \name Methods that can cause the TCPSender to send a segment
     //!@{
 
+    //! \brief SACK blocks arrived (with the acknowledgment that follows)
+    //! \details Call before ack_received() for the same segment, so that recovery can resend only the holes.
+    void sack_received(const std::vector<std::pair<WrappingInt32, WrappingInt32>> &blocks);
+
     //! \brief A new acknowledgment was received
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    void ack_received(const WrappingInt32 ackno,
+                      const size_t window_size,
+                      const bool occupies_sequence_space = false);
+
+    //! \brief The peer's SYN offered an MSS: send no more than that per segment
+    //! \note Only takes effect before any data has been sent
+    void set_peer_mss(const size_t peer_mss);
 
     //! \brief Generate an empty-payload segment (useful for creating empty ACK segments)
     void send_empty_segment();
@@ -105,6 +242,9 @@ class TCPSender {
 
     //! \brief Notifies the TCPSender of the passage of time
     void tick(const size_t ms_since_last_tick);
+
+    //! \brief Notifies the TCPSender of the passage of time, with the resolution the pacer needs
+    void tick_us(const uint64_t us_since_last_tick);
     //!@}
 
     //! \name Accessors
@@ -118,6 +258,35 @@ class TCPSender {
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief The first sequence number not yet acknowledged
+    WrappingInt32 unacked_seqno() const { return current_ackno; }
+
+    //! \brief The receiver's window, as of the latest acknowledgment
+    size_t peer_window() const { return current_win_size; }
+
+    //! \brief The most payload a segment carries on the wire
+    size_t mss() const { return _mss; }
+
+    //! \brief Smoothed round-trip time in milliseconds (empty until an RTT has been measured)
+    std::optional<double> srtt() const { return _rtt.srtt(); }
+
+    //! \brief Current retransmission timeout in milliseconds, including any exponential backoff
+    unsigned int rto() const { return _timer.timeout(); }
+
+    //! \brief The rate the pacer releases new segments at, in bytes per millisecond
+    //! \returns empty if pacing is off, or there's no RTT sample to derive the rate from yet
+    std::optional<double> pacing_rate() const;
+
+    //! \brief Microseconds until the pacer releases a segment it's holding back (empty if it isn't)
+    std::optional<uint64_t> pacing_delay_us() const;
+
+    //! \brief Microseconds until tick_us() has something to do: the retransmission timer expires, or
+    //! the pacer releases a segment (empty if neither is pending)
+    std::optional<uint64_t> next_deadline_us() const;
+
+    //! \brief The congestion control algorithm in use, or `nullptr` if there is none
+    const CongestionController *congestion_controller() const { return _congestion.get(); }
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
@@ -7,11 +7,33 @@ void Buffer::remove_prefix(const size_t n) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
+    if (_storage and _starting_offset + _ending_offset == _storage->size()) {
         _storage.reset();
+        _starting_offset = _ending_offset = 0;
     }
 }
 
+void Buffer::remove_suffix(const size_t n) {
+    if (n > str().size()) {
+        throw out_of_range("Buffer::remove_suffix");
+    }
+    _ending_offset += n;
+    if (_storage and _starting_offset + _ending_offset == _storage->size()) {
+        _storage.reset();
+        _starting_offset = _ending_offset = 0;
+    }
+}
+
+bool Buffer::try_append(const string_view data, const size_t max_size) {
+    // another Buffer would see the new bytes too, or (if it ends before them) should never see them
+    if (not _storage or _storage.use_count() != 1 or _ending_offset != 0 or
+        _storage->size() + data.size() > max_size) {
+        return false;
+    }
+    _storage->append(data);
+    return true;
+}
+
 void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
@@ -70,6 +92,12 @@ BufferViewList::BufferViewList(const BufferList &buffers) {
     }
 }
 
+BufferViewList::BufferViewList(const vector<iovec> &iovecs) {
+    for (const auto &x : iovecs) {
+        _views.push_back({static_cast<const char *>(x.iov_base), x.iov_len});
+    }
+}
+
 void BufferViewList::remove_prefix(size_t n) {
     while (n > 0) {
         if (_views.empty()) {
@@ -10,11 +10,12 @@
 #include <sys/uio.h>
 #include <vector>
 
-//! \brief A reference-counted read-only string that can discard bytes from the front
+//! \brief A reference-counted read-only string that can discard bytes from the front or back
 class Buffer {
   private:
     std::shared_ptr<std::string> _storage{};
     size_t _starting_offset{};
+    size_t _ending_offset{};  //!< number of bytes discarded from the back of `_storage`
 
   public:
     Buffer() = default;
@@ -28,7 +29,7 @@ class Buffer {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset - _ending_offset};
     }
 
     operator std::string_view() const { return str(); }
@@ -40,12 +41,27 @@ class Buffer {
     //! \brief Size of the string
     size_t size() const { return str().size(); }
 
+    //! \brief Bytes allocated for the underlying string, all of which stay in use while any copy of the Buffer does
+    size_t storage_capacity() const { return _storage ? _storage->capacity() : 0; }
+
+    //! \brief Is `other` a slice of the same string?
+    bool shares_storage(const Buffer &other) const { return _storage and _storage == other._storage; }
+
     //! \brief Make a copy to a new std::string
     std::string copy() const { return std::string(str()); }
 
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Discard the last `n` bytes of the string (does not require a copy or move)
+    //! \note Like remove_prefix(), only this copy of the Buffer is shortened.
+    void remove_suffix(const size_t n);
+
+    //! \brief Append `data` to the string in place, if no other Buffer shares it, this one reaches its end,
+    //! and it would then be no longer than `max_size`
+    //! \returns `false` (leaving the Buffer as it was) if not
+    bool try_append(const std::string_view data, const size_t max_size);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -112,6 +128,9 @@ class BufferViewList {
 
     //! \brief Construct from a std::string_view
     BufferViewList(std::string_view str) { _views.push_back({const_cast<char *>(str.data()), str.size()}); }
+
+    //! \brief Construct from a vector of `iovec` structures (the inverse of as_iovecs())
+    BufferViewList(const std::vector<iovec> &iovecs);
     //!@}
 
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
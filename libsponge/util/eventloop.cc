@@ -59,6 +59,13 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //! will result in a busy loop (poll returns on a ready file descriptor; file descriptor is not read or
 //! written, so it is still ready; the next call to poll will immediately return).
 EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+    return wait_next_event(timeout_ms < 0 ? chrono::microseconds{-1} : chrono::milliseconds{timeout_ms});
+}
+
+//! \param[in] timeout is the timeout passed to [ppoll(2)](\ref man2::poll), or negative to wait indefinitely
+//! \returns Eventloop::Result indicating success, timeout, or no more Rule objects to poll.
+//! \details Otherwise the same as wait_next_event(const int), which calls this.
+EventLoop::Result EventLoop::wait_next_event(const chrono::microseconds timeout) {
     vector<pollfd> pollfds{};
     pollfds.reserve(_rules.size());
     bool something_to_poll = false;
@@ -95,7 +102,10 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
 
     // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
     try {
-        if (0 == SystemCall("poll", ::poll(pollfds.data(), pollfds.size(), timeout_ms))) {
+        const auto seconds = chrono::duration_cast<chrono::seconds>(timeout);
+        const timespec timeout_ts{seconds.count(), chrono::nanoseconds{timeout - seconds}.count()};
+        const timespec *const timeout_ptr = timeout.count() < 0 ? nullptr : &timeout_ts;
+        if (0 == SystemCall("ppoll", ::ppoll(pollfds.data(), pollfds.size(), timeout_ptr, nullptr))) {
             return Result::Timeout;
         }
     } catch (unix_error const &e) {
@@ -73,6 +73,27 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+//! \param[in] buffers are the spans to fill, in order, with one call to [readv(2)](\ref man2::readv)
+//! \returns the number of bytes read; fewer than the total size of `buffers` may be read
+size_t FileDescriptor::read(const vector<iovec> &buffers) {
+    size_t size_to_read = 0;
+    for (const auto &x : buffers) {
+        size_to_read += x.iov_len;
+    }
+
+    const ssize_t bytes_read = SystemCall("readv", ::readv(fd_num(), buffers.data(), buffers.size()));
+    if (size_to_read > 0 && bytes_read == 0) {
+        _internal_fd->_eof = true;
+    }
+    if (bytes_read > static_cast<ssize_t>(size_to_read)) {
+        throw runtime_error("readv() read more than requested");
+    }
+
+    register_read();
+
+    return bytes_read;
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
@@ -74,6 +74,16 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name Overwrite an integer already in the data stream, at byte `offset` (for patching header templates)
+    //!@{
+    template <typename T>
+    static void _patch_int(std::string &s, const size_t offset, T val);
+
+    static void u32(std::string &s, const size_t offset, const uint32_t val);
+    static void u16(std::string &s, const size_t offset, const uint16_t val);
+    static void u8(std::string &s, const size_t offset, const uint8_t val);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
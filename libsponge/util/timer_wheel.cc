@@ -0,0 +1,160 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! \param[in] entry is the entry to check
+bool TimerWheel::_live(const Entry &entry) const {
+    const auto timer = _timers.find(entry.id);
+    return timer != _timers.end() and timer->second.deadline == optional<uint64_t>{entry.deadline};
+}
+
+//! \param[in] entry is the entry to file
+void TimerWheel::_place(const Entry &entry) {
+    if (entry.deadline <= _now) {
+        _due.push_back(entry);
+        return;
+    }
+
+    // the level is set by the highest bit in which the deadline differs from now
+    const uint64_t differs = entry.deadline ^ _now;
+    unsigned int level = 0;
+    while (level < LEVELS and (differs >> (LEVEL_BITS * (level + 1))) != 0) {
+        level++;
+    }
+    if (level == LEVELS) {
+        _overflow.push_back(entry);
+    } else {
+        _slots[level][(entry.deadline >> (LEVEL_BITS * level)) % SLOTS].push_back(entry);
+    }
+}
+
+//! \param[in] time is the new time, no later than any deadline
+void TimerWheel::_move_to(const uint64_t time) {
+    const uint64_t before = _now;
+    if (time == before) {
+        return;
+    }
+    _now = time;
+
+    // from the top down, so that what one level brings down, the next can bring down further
+    if ((before >> (LEVEL_BITS * LEVELS)) != (time >> (LEVEL_BITS * LEVELS))) {
+        for (const auto &entry : exchange(_overflow, {})) {
+            _place(entry);
+        }
+    }
+    for (unsigned int level = LEVELS; level-- > 0;) {
+        if (level > 0 and (before >> (LEVEL_BITS * level)) == (time >> (LEVEL_BITS * level))) {
+            continue;
+        }
+        auto &slot = _slots[level][(time >> (LEVEL_BITS * level)) % SLOTS];
+        for (const auto &entry : exchange(slot, {})) {
+            if (_live(entry)) {
+                _place(entry);
+            }
+        }
+    }
+}
+
+void TimerWheel::_fire_due() {
+    // only what is due already: a timer armed for now by a callback fires on the next pass
+    for (const auto &entry : exchange(_due, {})) {
+        const auto timer = _timers.find(entry.id);
+        if (timer == _timers.end() or timer->second.deadline != optional<uint64_t>{entry.deadline}) {
+            continue;
+        }
+        timer->second.deadline.reset();
+        // a copy, in case the callback removes its own timer
+        const CallbackT callback = timer->second.callback;
+        callback();
+    }
+}
+
+optional<uint64_t> TimerWheel::_next_slot() const {
+    // every deadline on a level comes before any on the levels above it, and within a level, the
+    // slots after now's come in order (those before it are empty, or hold only stale entries)
+    for (unsigned int level = 0; level < LEVELS; level++) {
+        const uint64_t above = _now >> (LEVEL_BITS * (level + 1)) << (LEVEL_BITS * (level + 1));
+        for (uint64_t index = (_now >> (LEVEL_BITS * level)) % SLOTS + 1; index < SLOTS; index++) {
+            if (not _slots[level][index].empty()) {
+                return above | (index << (LEVEL_BITS * level));
+            }
+        }
+    }
+    if (not _overflow.empty()) {
+        return (_now >> (LEVEL_BITS * LEVELS) << (LEVEL_BITS * LEVELS)) + (uint64_t{1} << (LEVEL_BITS * LEVELS));
+    }
+    return {};
+}
+
+//! \param[in] callback is called each time the timer expires
+//! \returns the new timer's id
+TimerWheel::TimerId TimerWheel::add_timer(CallbackT callback) {
+    const TimerId id = _next_id++;
+    _timers.emplace(id, Timer{move(callback), {}});
+    return id;
+}
+
+//! \param[in] id is the timer to remove
+void TimerWheel::remove_timer(const TimerId id) { _timers.erase(id); }
+
+//! \param[in] id is the timer to arm
+//! \param[in] delay_ms is how long from now it expires, in milliseconds
+void TimerWheel::arm(const TimerId id, const uint64_t delay_ms) {
+    const auto timer = _timers.find(id);
+    if (timer == _timers.end()) {
+        throw runtime_error("TimerWheel::arm: no such timer");
+    }
+    const uint64_t deadline = _now + delay_ms;
+    if (timer->second.deadline == optional<uint64_t>{deadline}) {
+        return;
+    }
+    timer->second.deadline = deadline;
+    _place({id, deadline});
+}
+
+//! \param[in] id is the timer to disarm
+void TimerWheel::disarm(const TimerId id) {
+    const auto timer = _timers.find(id);
+    if (timer != _timers.end()) {
+        timer->second.deadline.reset();
+    }
+}
+
+//! \param[in] id is the timer to check
+bool TimerWheel::armed(const TimerId id) const {
+    const auto timer = _timers.find(id);
+    return timer != _timers.end() and timer->second.deadline.has_value();
+}
+
+//! \param[in] ms is how far to advance the clock, in milliseconds
+//! \details The clock jumps from one occupied slot to the next, so that advancing it costs nothing
+//! for the milliseconds in which no timer expires.
+void TimerWheel::advance(const uint64_t ms) {
+    const uint64_t target = _now + ms;
+    while (true) {
+        _fire_due();
+        const auto next = _next_slot();
+        if (not next.has_value() or next.value() > target) {
+            break;
+        }
+        _move_to(next.value());
+    }
+    _move_to(target);
+}
+
+optional<uint64_t> TimerWheel::next_expiry() const {
+    for (const auto &entry : _due) {
+        if (_live(entry)) {
+            return 0;
+        }
+    }
+    const auto next = _next_slot();
+    if (not next.has_value()) {
+        return {};
+    }
+    return next.value() - _now;
+}
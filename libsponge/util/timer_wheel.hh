@@ -0,0 +1,100 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! Timers for many owners on one millisecond clock, each firing a callback when it expires
+class TimerWheel {
+  public:
+    using TimerId = uint64_t;                     //!< Names a timer from add_timer() until remove_timer()
+    using CallbackT = std::function<void(void)>;  //!< Called when a timer expires
+
+    static constexpr unsigned int LEVEL_BITS = 6;             //!< each level resolves this many bits of a deadline
+    static constexpr size_t SLOTS = size_t{1} << LEVEL_BITS;  //!< slots per level
+    static constexpr unsigned int LEVELS = 4;                 //!< levels, spanning 2^24 ms (about 4.7 hours)
+
+  private:
+    //! A timer, armed if it has a deadline
+    struct Timer {
+        CallbackT callback;
+        std::optional<uint64_t> deadline;
+    };
+
+    //! A timer's place on the wheel. Re-arming or disarming a timer leaves its old entries behind, stale,
+    //! to be dropped when their slot comes round rather than searched for.
+    struct Entry {
+        TimerId id;
+        uint64_t deadline;
+    };
+
+    uint64_t _now{0};  //!< milliseconds advanced so far; every timer due by now has fired
+    TimerId _next_id{0};
+    std::unordered_map<TimerId, Timer> _timers{};
+
+    //! Level `k` holds the deadlines that agree with `_now` above bit LEVEL_BITS * (k + 1) but not above
+    //! LEVEL_BITS * k, in the slot named by their bits in between. A slot moves down a level when `_now`
+    //! reaches it, and level 0's slots hold single milliseconds, so each entry moves at most LEVELS times.
+    std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> _slots{};
+    std::vector<Entry> _overflow{};  //!< deadlines beyond the top level
+    std::vector<Entry> _due{};       //!< deadlines that have come, to fire
+
+    //! \returns whether `entry` is still where its timer is due
+    bool _live(const Entry &entry) const;
+
+    //! File `entry` in the level and slot its deadline falls in, relative to `_now`
+    void _place(const Entry &entry);
+
+    //! Move the clock forward to `time`, which is no later than any deadline, bringing down the slots it reaches
+    void _move_to(const uint64_t time);
+
+    //! Fire the timers that are due
+    void _fire_due();
+
+    //! \returns when the first occupied slot after `_now` begins (the time to move it down a level, or fire
+    //! it), if any: no later than the earliest deadline, and found without looking at any timer
+    std::optional<uint64_t> _next_slot() const;
+
+  public:
+    //! Add a timer, disarmed, that calls `callback` each time it expires
+    TimerId add_timer(CallbackT callback);
+
+    //! Remove a timer for good
+    void remove_timer(const TimerId id);
+
+    //! (Re)arm a timer to expire `delay_ms` milliseconds from now
+    void arm(const TimerId id, const uint64_t delay_ms);
+
+    //! Disarm a timer, if it is armed
+    void disarm(const TimerId id);
+
+    //! \returns whether a timer is armed
+    bool armed(const TimerId id) const;
+
+    //! Advance the clock by `ms`, firing (and disarming) each timer that expires, in the order they expire
+    void advance(const uint64_t ms);
+
+    //! \returns milliseconds since the wheel was constructed
+    uint64_t now() const { return _now; }
+
+    //! \returns milliseconds until advance() next has work to do (0 if a timer is already due), or empty if
+    //! there's nothing on the wheel. That's when the next timer expires, or sooner if that one is far off and
+    //! must first be moved down a level: sleeping this long may wake early, but never late.
+    std::optional<uint64_t> next_expiry() const;
+};
+
+//! \class TimerWheel
+//!
+//! A hierarchical timing wheel (Varghese and Lauck, 1987): arming, disarming and the work of advancing the
+//! clock cost (amortized) constant time per timer that expires, however many timers are armed. An owner of
+//! many connections arms one timer per connection for when that connection next needs a tick, advances the
+//! wheel as time passes, and sleeps until next_expiry() in between.
+//!
+//! A callback may arm, disarm, add or remove timers, including its own.
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
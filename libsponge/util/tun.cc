@@ -7,6 +7,7 @@
 #include <linux/if.h>
 #include <linux/if_tun.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 
 static constexpr const char *CLONEDEV = "/dev/net/tun";
 
@@ -34,3 +35,12 @@ TunTapFD::TunTapFD(const string &devname, const bool is_tun)
 
     SystemCall("ioctl", ioctl(fd_num(), TUNSETIFF, static_cast<void *>(&tun_req)));
 }
+
+unsigned int TunTapFD::mtu() const {
+    // ask the device its name, then ask the kernel (through any socket) its MTU
+    struct ifreq req {};
+    SystemCall("ioctl", ioctl(fd_num(), TUNGETIFF, static_cast<void *>(&req)));
+    const FileDescriptor sock{SystemCall("socket", socket(AF_INET, SOCK_DGRAM, 0))};
+    SystemCall("ioctl", ioctl(sock.fd_num(), SIOCGIFMTU, static_cast<void *>(&req)));
+    return req.ifr_mtu;
+}
@@ -10,6 +10,9 @@ class TunTapFD : public FileDescriptor {
   public:
     //! Open an existing persistent [TUN or TAP device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
     explicit TunTapFD(const std::string &devname, const bool is_tun);
+
+    //! The device's MTU: the largest IP datagram it carries
+    unsigned int mtu() const;
 };
 
 //! A FileDescriptor to a [Linux TUN](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
@@ -3,6 +3,8 @@
 #include <array>
 #include <cctype>
 #include <chrono>
+#include <cstring>
+#include <endian.h>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -10,14 +12,19 @@
 
 using namespace std;
 
-//! \returns the number of milliseconds since the program started
-uint64_t timestamp_ms() {
+//! \returns the time elapsed since the program started (or at least, since it first asked)
+static std::chrono::steady_clock::duration time_since_start() {
     using time_point = std::chrono::steady_clock::time_point;
     static const time_point program_start = std::chrono::steady_clock::now();
-    const time_point now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now - program_start).count();
+    return std::chrono::steady_clock::now() - program_start;
 }
 
+//! \returns the number of milliseconds since the program started
+uint64_t timestamp_ms() { return std::chrono::duration_cast<std::chrono::milliseconds>(time_since_start()).count(); }
+
+//! \returns the number of microseconds since the program started
+uint64_t timestamp_us() { return std::chrono::duration_cast<std::chrono::microseconds>(time_since_start()).count(); }
+
 //! \param[in] attempt is the name of the syscall to try (for error reporting)
 //! \param[in] return_value is the return value of the syscall
 //! \param[in] errno_mask is any errno value that is acceptable, e.g., `EAGAIN` when reading a non-blocking fd
@@ -87,13 +94,41 @@ mt19937 get_random_generator() {
 InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
 
 void InternetChecksum::add(std::string_view data) {
-    for (size_t i = 0; i < data.size(); i++) {
-        uint16_t val = uint8_t(data[i]);
-        if (not _parity) {
-            val <<= 8;
-        }
-        _sum += val;
-        _parity = !_parity;
+    size_t i = 0;
+
+    // a byte left over from the last call is the low half of its word
+    if (_parity and not data.empty()) {
+        _sum += uint8_t(data[0]);
+        _parity = false;
+        i = 1;
+    }
+
+    // The sum comes out the same in either byte order, just byte-swapped (RFC 1071 section 2(B)), so
+    // add eight bytes at a time as they lie in memory, in 32-bit halves so that no payload can
+    // overflow the total, and fold and swap once at the end
+    uint64_t words = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t eight_bytes;
+        memcpy(&eight_bytes, data.data() + i, sizeof(eight_bytes));
+        words += (eight_bytes >> 32) + (eight_bytes & 0xffffffff);
+    }
+    for (; i + 2 <= data.size(); i += 2) {
+        uint16_t two_bytes;
+        memcpy(&two_bytes, data.data() + i, sizeof(two_bytes));
+        words += two_bytes;
+    }
+    while (words > 0xffff) {
+        words = (words >> 16) + (words & 0xffff);
+    }
+    _sum += be16toh(static_cast<uint16_t>(words));
+
+    if (i < data.size()) {
+        _sum += uint8_t(data[i]) << 8;
+        _parity = true;
+    }
+
+    while (_sum > 0xffff) {
+        _sum = (_sum >> 16) + (_sum & 0xffff);
     }
 }
 
@@ -0,0 +1,143 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ByteStreamTestHarness test{"chunked write-write-pop-pop", 15, ByteStream::Storage::Chunked};
+
+            test.execute(WriteBuffer{"cat"}.with_bytes_written(3));
+            test.execute(WriteBuffer{"tac"}.with_bytes_written(3));
+
+            test.execute(BytesWritten{6});
+            test.execute(RemainingCapacity{9});
+            test.execute(BufferSize{6});
+            test.execute(Peek{"cattac"});
+            test.execute(PeekBuffers{"cattac", 2});
+            test.execute(PeekBuffers{"catt", 2});
+
+            test.execute(Pop{2});
+
+            test.execute(BytesRead{2});
+            test.execute(RemainingCapacity{11});
+            test.execute(BufferSize{4});
+            test.execute(PeekBuffers{"ttac", 2});
+
+            test.execute(Pop{4});
+            test.execute(EndInput{});
+
+            test.execute(BufferEmpty{true});
+            test.execute(Eof{true});
+            test.execute(BytesRead{6});
+            test.execute(RemainingCapacity{15});
+        }
+
+        {
+            ByteStreamTestHarness test{"chunked overwrite", 2, ByteStream::Storage::Chunked};
+
+            test.execute(WriteBuffer{"cat"}.with_bytes_written(2));
+            test.execute(WriteBuffer{"t"}.with_bytes_written(0));
+
+            test.execute(RemainingCapacity{0});
+            test.execute(BufferSize{2});
+            test.execute(PeekBuffers{"ca", 1});
+
+            test.execute(Pop{1});
+            test.execute(Write{"tac"}.with_bytes_written(1));
+
+            test.execute(BufferSize{2});
+            test.execute(Peek{"at"});
+            test.execute(PeekBuffers{"at", 2});
+        }
+
+        {
+            ByteStreamTestHarness test{"chunked read_buffer", 15, ByteStream::Storage::Chunked};
+
+            test.execute(WriteBuffer{"cat"}.with_bytes_written(3));
+            test.execute(Write{"tac"}.with_bytes_written(3));
+
+            test.execute(ReadBuffer{"ca"});
+            test.execute(ReadBuffer{"tta"});
+            test.execute(BytesRead{5});
+            test.execute(BufferSize{1});
+            test.execute(ReadBuffer{""});
+            test.execute(ReadBuffer{"c"});
+            test.execute(BufferEmpty{true});
+        }
+
+        {
+            ByteStreamTestHarness test{"chunked small writes coalesce", 15, ByteStream::Storage::Chunked};
+
+            test.execute(Write{"cat"}.with_bytes_written(3));
+            test.execute(Write{"tac"}.with_bytes_written(3));
+            test.execute(PeekBuffers{"cattac", 1});
+            test.execute(Pop{4});
+            test.execute(Write{"dog"}.with_bytes_written(3));
+            test.execute(PeekBuffers{"acdog", 1});
+            test.execute(WriteBuffer{"god"}.with_bytes_written(3));
+            test.execute(PeekBuffers{"acdoggod", 2});
+        }
+
+        {
+            ByteStreamTestHarness test{"ring peek_buffers", 3};
+
+            test.execute(WriteBuffer{"cat"}.with_bytes_written(3));
+            test.execute(Pop{2});
+            test.execute(WriteBuffer{"tac"}.with_bytes_written(2));
+
+            test.execute(BufferSize{3});
+            test.execute(PeekBuffers{"tta", 1});
+        }
+
+        {
+            // peek_buffers() in chunked mode must share the written storage instead of copying it
+            ByteStream stream{1000, ByteStream::Storage::Chunked};
+            const Buffer data{string(100, 'x')};
+            if (stream.write(data) != 100) {
+                throw runtime_error("chunked write accepted fewer bytes than expected");
+            }
+            stream.pop_output(10);
+            const BufferList peeked = stream.peek_buffers(50);
+            if (peeked.buffers().size() != 1 or peeked.buffers().front().str().data() != data.str().data() + 10) {
+                throw runtime_error("peek_buffers() copied the written Buffer");
+            }
+
+            // ... and so must read_buffer() when one written Buffer holds everything read
+            const Buffer read = stream.read_buffer(50);
+            if (read.str().data() != data.str().data() + 10 or stream.bytes_read() != 60) {
+                throw runtime_error("read_buffer() copied the written Buffer");
+            }
+        }
+
+        {
+            // a small write is appended to the last chunk only while no other Buffer shares it
+            ByteStream stream{10000, ByteStream::Storage::Chunked};
+            stream.write(string(100, 'a'));
+            const Buffer read = stream.read_buffer(50);
+            stream.write(string(100, 'b'));
+            if (stream.peek_buffers(150).buffers().size() != 2 or read.str() != string(50, 'a')) {
+                throw runtime_error("a write was appended to a shared chunk");
+            }
+
+            // ... and while that keeps it short
+            stream.pop_output(stream.buffer_size());
+            stream.write(string(100, 'c'));
+            stream.write(string(3000, 'd'));
+            stream.write(string(1000, 'e'));
+            if (stream.peek_buffers(4100).buffers().size() != 2 or
+                stream.peek_output(4100) != string(100, 'c') + string(3000, 'd') + string(1000, 'e')) {
+                throw runtime_error("a write made a chunk too long");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include "byte_stream.hh"
+#include "file_descriptor.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <climits>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe", ::pipe(static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+static void expect_bytes(const string &actual, const string &expected) {
+    if (actual != expected) {
+        throw runtime_error("expected \"" + expected + "\" but got \"" + actual + "\"");
+    }
+}
+
+static void check_round_trip(const ByteStream::Storage storage) {
+    auto [in_read, in_write] = make_pipe();
+    auto [out_read, out_write] = make_pipe();
+
+    ByteStream stream{8, storage};
+    test_should_be(stream.write("abcdef"), size_t(6));
+    stream.pop_output(5);
+
+    // the ring's free space now wraps around the end of its storage
+    in_write.write("hello world");
+    test_should_be(stream.write_from(in_read, 100), size_t(7));
+    expect_bytes(stream.peek_output(8), "fhello w");
+    test_should_be(stream.bytes_written(), size_t(13));
+    test_should_be(stream.remaining_capacity(), size_t(0));
+
+    // a full stream reads nothing, and that is not EOF
+    test_should_be(stream.write_from(in_read, 100), size_t(0));
+    test_should_be(in_read.eof(), false);
+
+    test_should_be(stream.read_into(out_write, 3), size_t(3));
+    test_should_be(stream.read_into(out_write, 100), size_t(5));
+    test_should_be(stream.buffer_empty(), true);
+    test_should_be(stream.bytes_read(), size_t(13));
+    expect_bytes(out_read.read(100), "fhello w");
+
+    test_should_be(stream.write_from(in_read, 100), size_t(4));
+    expect_bytes(stream.peek_output(4), "orld");
+
+    in_write.close();
+    test_should_be(stream.write_from(in_read, 100), size_t(0));
+    test_should_be(in_read.eof(), true);
+}
+
+// more chunks than writev(2) takes at once are written out over several calls
+static void check_many_chunks() {
+    auto [out_read, out_write] = make_pipe();
+
+    constexpr size_t chunk_count = 3 * IOV_MAX;
+    ByteStream stream{chunk_count, ByteStream::Storage::Chunked};
+    string expected;
+    for (size_t i = 0; i < chunk_count; i++) {
+        expected.push_back(char('a' + i % 26));
+        test_should_be(stream.write(Buffer(expected.substr(i))), size_t(1));  // a Buffer is never coalesced
+    }
+    test_should_be(stream.output_iovecs(chunk_count).size(), size_t(IOV_MAX));
+
+    string actual;
+    while (not stream.buffer_empty()) {
+        test_should_be(stream.read_into(out_write, chunk_count) <= IOV_MAX, true);
+        actual += out_read.read(chunk_count);
+    }
+    expect_bytes(actual, expected);
+}
+
+int main() {
+    try {
+        check_round_trip(ByteStream::Storage::Ring);
+        check_round_trip(ByteStream::Storage::Chunked);
+        check_many_chunks();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -45,11 +45,14 @@ void ByteStreamAction::execute(ByteStream &) const {}
 
 ByteStreamAction::~ByteStreamAction() {}
 
-ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name, const size_t capacity)
-    : _test_name(test_name), _byte_stream(capacity) {
+ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name,
+                                             const size_t capacity,
+                                             const ByteStream::Storage storage)
+    : _test_name(test_name), _byte_stream(capacity, storage) {
     std::ostringstream ss;
     ss << "Initialized with ("
-       << "capacity=" << capacity << ")";
+       << "capacity=" << capacity << ", storage=" << (storage == ByteStream::Storage::Ring ? "ring" : "chunked")
+       << ")";
     _steps_executed.emplace_back(ss.str());
 }
 
@@ -97,11 +100,36 @@ void Write::execute(ByteStream &bs) const {
     }
 }
 
+// WriteBuffer
+WriteBuffer::WriteBuffer(const std::string &data) : _data(data) {}
+WriteBuffer &WriteBuffer::with_bytes_written(const size_t bytes_written) {
+    _bytes_written = bytes_written;
+    return *this;
+}
+std::string WriteBuffer::description() const { return "write Buffer \"" + _data + "\" to the stream"; }
+void WriteBuffer::execute(ByteStream &bs) const {
+    auto bytes_written = bs.write(Buffer(std::string(_data)));
+    if (_bytes_written and bytes_written != _bytes_written.value()) {
+        throw ByteStreamExpectationViolation::property("bytes_written", _bytes_written.value(), bytes_written);
+    }
+}
+
 // Pop
 Pop::Pop(const size_t len) : _len(len) {}
 std::string Pop::description() const { return "pop " + to_string(_len); }
 void Pop::execute(ByteStream &bs) const { bs.pop_output(_len); }
 
+// ReadBuffer
+ReadBuffer::ReadBuffer(const std::string &output) : _output(output) {}
+std::string ReadBuffer::description() const { return "read_buffer " + to_string(_output.size()); }
+void ReadBuffer::execute(ByteStream &bs) const {
+    const auto output = bs.read_buffer(_output.size());
+    if (output.str() != _output) {
+        throw ByteStreamExpectationViolation("Expected to read \"" + _output + "\" as a Buffer, but read \"" +
+                                             output.copy() + "\"");
+    }
+}
+
 // InputEnded
 InputEnded::InputEnded(const bool input_ended) : _input_ended(input_ended) {}
 std::string InputEnded::description() const { return "input_ended: " + to_string(_input_ended); }
@@ -182,3 +210,21 @@ void Peek::execute(ByteStream &bs) const {
                                              output + "\"");
     }
 }
+
+// PeekBuffers
+PeekBuffers::PeekBuffers(const std::string &output, const size_t num_buffers)
+    : _output(output), _num_buffers(num_buffers) {}
+std::string PeekBuffers::description() const {
+    return "\"" + _output + "\" at the front of the stream in " + to_string(_num_buffers) + " Buffer(s)";
+}
+void PeekBuffers::execute(ByteStream &bs) const {
+    const BufferList output = bs.peek_buffers(_output.size());
+    if (output.concatenate() != _output) {
+        throw ByteStreamExpectationViolation("Expected \"" + _output + "\" at the front of the stream, but found \"" +
+                                             output.concatenate() + "\"");
+    }
+    if (output.buffers().size() != _num_buffers) {
+        throw ByteStreamExpectationViolation::property(
+            "number of peeked Buffers", _num_buffers, output.buffers().size());
+    }
+}
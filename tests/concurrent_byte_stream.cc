@@ -0,0 +1,86 @@
+#include "concurrent_byte_stream.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// Stream `len` bytes from a writer thread to the reader through a small ring (so that
+// nearly every write and read wraps), and check that they arrive intact and in order.
+static void check_handoff(const size_t capacity, const bool use_eventfd) {
+    constexpr size_t len = 1 << 20;
+
+    string data(len, 0);
+    auto rd = get_random_generator();
+    for (auto &ch : data) {
+        ch = rd();
+    }
+
+    ConcurrentByteStream stream{capacity, use_eventfd};
+
+    thread writer([&] {
+        auto writer_rd = get_random_generator();
+        for (size_t sent = 0; sent < len;) {
+            const size_t want = min(len - sent, size_t(1 + writer_rd() % (2 * capacity)));
+            const size_t written = stream.write(string_view(data).substr(sent, want));
+            if (written == 0 and use_eventfd) {
+                stream.wait_writable();
+            } else if (written == 0) {
+                this_thread::yield();
+            }
+            sent += written;
+        }
+        stream.end_input();
+    });
+
+    string received;
+    received.reserve(len);
+    while (not stream.eof()) {
+        const string chunk = stream.read(1 + rd() % (2 * capacity));
+        if (chunk.empty() and use_eventfd) {
+            stream.wait_readable();
+        } else if (chunk.empty()) {
+            this_thread::yield();
+        }
+        received.append(chunk);
+    }
+    writer.join();
+
+    test_should_be(received.size(), len);
+    test_should_be(received == data, true);
+    test_should_be(stream.bytes_written(), len);
+    test_should_be(stream.bytes_read(), len);
+    test_should_be(stream.remaining_capacity(), capacity);
+}
+
+int main() {
+    try {
+        {
+            ConcurrentByteStream stream{4};
+            test_should_be(stream.write("cat"), size_t(3));
+            test_should_be(stream.write("tac"), size_t(1));
+            test_should_be(stream.remaining_capacity(), size_t(0));
+            test_should_be(stream.read(2) == "ca", true);
+            test_should_be(stream.write("tac"), size_t(2));
+            test_should_be(stream.read(10) == "ttta", true);
+            test_should_be(stream.buffer_empty(), true);
+            test_should_be(stream.eof(), false);
+            stream.end_input();
+            test_should_be(stream.eof(), true);
+        }
+
+        check_handoff(7, false);
+        check_handoff(7, true);
+        check_handoff(4096, true);
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
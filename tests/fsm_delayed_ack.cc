@@ -0,0 +1,134 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.ack_delay = TCPConfig::ACK_DELAY_DFLT;
+
+        string d(8 * MSS, 0);
+        generate(d.begin(), d.end(), [&] { return rd(); });
+
+        // every second full-sized segment is ACKed at once
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            for (size_t i = 0; i < 6; i++) {
+                test_1.send_data(rx_isn + 1 + i * MSS, tx_isn + 1, d.cbegin() + i * MSS, d.cbegin() + (i + 1) * MSS);
+                if (i % 2 == 0) {
+                    test_1.execute(ExpectNoSegment{}, "test 1 failed: ACKed the first of two segments");
+                } else {
+                    test_1.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + (i + 1) * MSS),
+                                   "test 1 failed: no ACK for the second of two segments");
+                }
+            }
+        }
+
+        // a lone segment is ACKed when the delay is up
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_2.send_data(rx_isn + 1, tx_isn + 1, d.cbegin(), d.cbegin() + 100);
+            test_2.execute(Tick(cfg.ack_delay - 1));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: ACKed before the delay was up");
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 101),
+                           "test 2 failed: no ACK when the delay was up");
+            test_2.execute(Tick(10 * cfg.ack_delay));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: ACKed twice");
+        }
+
+        // out-of-order data, the segment that fills the hole, and a FIN are ACKed at once
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_3 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_3.send_data(rx_isn + 1 + MSS, tx_isn + 1, d.cbegin() + MSS, d.cbegin() + 2 * MSS);
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1),
+                           "test 3 failed: no duplicate ACK for out-of-order data");
+            test_3.send_data(rx_isn + 1, tx_isn + 1, d.cbegin(), d.cbegin() + MSS);
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 2 * MSS),
+                           "test 3 failed: no ACK for the segment that filled the hole");
+            test_3.send_fin(rx_isn + 1 + 2 * MSS, tx_isn + 1);
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2 + 2 * MSS),
+                           "test 3 failed: no ACK for a FIN");
+        }
+
+        // once the reader frees up the window, the peer hears at once
+        {
+            TCPConfig small = cfg;
+            small.recv_capacity = 4 * MSS;
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_4 = TCPTestHarness::in_established(small, tx_isn, rx_isn);
+            for (size_t i = 0; i < 4; i++) {
+                test_4.send_data(rx_isn + 1 + i * MSS, tx_isn + 1, d.cbegin() + i * MSS, d.cbegin() + (i + 1) * MSS);
+            }
+            test_4.execute(ExpectSegment{}.with_ackno(rx_isn + 1 + 2 * MSS).with_win(2 * MSS),
+                           "test 4 failed: no ACK for the first two segments");
+            test_4.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1 + 4 * MSS).with_win(0),
+                           "test 4 failed: no ACK for the last two segments");
+            test_4.execute(Tick(1));
+            test_4.execute(ExpectNoSegment{}, "test 4 failed: window update before the window opened");
+            test_4.execute(ExpectData{}.with_data(d.substr(0, 4 * MSS)));
+            if (test_4._fsm.next_deadline_us() != optional<uint64_t>{0}) {
+                throw runtime_error("test 4 failed: window update not due at once");
+            }
+            test_4.execute(Tick(1));
+            test_4.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1 + 4 * MSS).with_win(4 * MSS),
+                           "test 4 failed: no window update");
+        }
+
+        // ... without waiting for a tick, if the owner says it has read
+        {
+            TCPConfig small = cfg;
+            small.recv_capacity = 4 * MSS;
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_5 = TCPTestHarness::in_established(small, tx_isn, rx_isn);
+            for (size_t i = 0; i < 4; i++) {
+                test_5.send_data(rx_isn + 1 + i * MSS, tx_isn + 1, d.cbegin() + i * MSS, d.cbegin() + (i + 1) * MSS);
+            }
+            test_5.execute(ExpectSegment{}.with_ackno(rx_isn + 1 + 2 * MSS).with_win(2 * MSS),
+                           "test 5 failed: no ACK for the first two segments");
+            test_5.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1 + 4 * MSS).with_win(0),
+                           "test 5 failed: no ACK for the last two segments");
+            test_5.execute(Read(MSS / 2));
+            test_5.execute(ExpectNoSegment{}, "test 5 failed: window update for a sliver of the window");
+            test_5.execute(Read(2 * MSS));
+            test_5.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1 + 4 * MSS).with_win(2 * MSS + MSS / 2),
+                           "test 5 failed: no window update");
+            test_5.execute(Read(0));
+            test_5.execute(ExpectNoSegment{}, "test 5 failed: window update sent twice");
+        }
+
+        // without ack_delay, each segment is ACKed at once
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_6 = TCPTestHarness::in_established({}, tx_isn, rx_isn);
+            test_6.send_data(rx_isn + 1, tx_isn + 1, d.cbegin(), d.cbegin() + MSS);
+            test_6.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + MSS),
+                           "test 6 failed: ACK held back without ack_delay");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
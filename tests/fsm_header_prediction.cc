@@ -0,0 +1,116 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! What a transfer put on the wire, and how much of it the receiving side predicted
+struct Transfer {
+    vector<string> wire{};  //!< every segment sent, both ways, serialized
+    string received{};
+    size_t processed{0};
+    size_t hits{0};
+};
+
+//! Deliver what `from` has queued to `to`, dropping and reordering segments as `rd` decides
+static void deliver(TCPConnection &from, TCPConnection &to, Transfer &transfer, mt19937 &rd, const bool lossy) {
+    vector<TCPSegment> segments;
+    for (; not from.segments_out().empty(); from.segments_out().pop()) {
+        transfer.wire.push_back(from.segments_out().front().serialize().concatenate());
+        if (not lossy or rd() % 50 != 0) {
+            segments.push_back(from.segments_out().front());
+        }
+    }
+    if (lossy and segments.size() > 1 and rd() % 4 == 0) {
+        const size_t i = rd() % (segments.size() - 1);
+        swap(segments[i], segments[i + 1]);
+    }
+    for (const auto &seg : segments) {
+        to.segment_received(seg);
+    }
+}
+
+//! Send `data` from one connection to another, each configured with `cfg`
+static Transfer transfer(TCPConfig cfg, const string &data, const uint32_t seed, const bool lossy) {
+    Transfer ret;
+    mt19937 rd{seed};
+    cfg.fixed_isn = WrappingInt32{seed};
+    TCPConnection x{cfg}, y{cfg};
+    x.connect();
+    size_t written = 0;
+    bool x_closed = false, y_closed = false;
+    for (unsigned int round = 0; x.active() or y.active(); round++) {
+        test_err_if(round > 100000, "transfer stalled");
+        written += x.write(data.substr(written, 3000));
+        if (written == data.size() and not x_closed) {
+            x.end_input_stream();
+            x_closed = true;
+        }
+        deliver(x, y, ret, rd, lossy);
+        deliver(y, x, ret, rd, lossy);
+        ret.received += y.inbound_stream().read(y.inbound_stream().buffer_size());
+        if (y.inbound_stream().eof() and not y_closed) {
+            y.end_input_stream();
+            y_closed = true;
+        }
+        x.tick(5);
+        y.tick(5);
+    }
+    ret.processed = x.segments_processed() + y.segments_processed();
+    ret.hits = x.fast_path_hits() + y.fast_path_hits();
+    return ret;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        string d(200000, 0);
+        generate(d.begin(), d.end(), [&] { return rd(); });
+
+        // the fast path changes nothing on the wire, lossy or not, and whatever the options; without loss,
+        // it handles nearly every segment
+        for (unsigned int variant = 0; variant < 5; variant++) {
+            TCPConfig cfg;
+            cfg.ack_delay = variant == 1 ? TCPConfig::ACK_DELAY_DFLT : 0;
+            cfg.sack = variant != 2;
+            cfg.recv_capacity_max = variant == 3 ? 8 * TCPConfig::DEFAULT_CAPACITY : 0;
+            if (variant == 4) {
+                cfg.congestion_control = TCPConfig::CongestionControl::NewReno;
+                cfg.pacing = true;
+                cfg.adaptive_rto = true;
+            }
+            for (const bool lossy : {false, true}) {
+                const uint32_t seed = rd();
+                const string name = "variant " + to_string(variant) + (lossy ? " with loss" : "");
+
+                cfg.header_prediction = true;
+                const Transfer fast = transfer(cfg, d, seed, lossy);
+                cfg.header_prediction = false;
+                const Transfer slow = transfer(cfg, d, seed, lossy);
+
+                test_err_if(fast.received != d or slow.received != d, name + ": wrong data");
+                test_err_if(fast.wire != slow.wire, name + ": the fast path changed what was sent");
+                test_err_if(slow.hits != 0, name + ": took the fast path with header prediction off");
+                test_err_if(not lossy and fast.hits * 10 < fast.processed * 9,
+                            name + ": only " + to_string(fast.hits) + " of " + to_string(fast.processed) +
+                                " segments took the fast path");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
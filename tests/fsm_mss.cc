@@ -0,0 +1,120 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//! Deliver every segment `from` has queued to `to`, serialized and parsed as if on the wire
+//! \returns the largest payload among them
+static size_t deliver(TCPConnection &from, TCPConnection &to) {
+    size_t largest = 0;
+    while (not from.segments_out().empty()) {
+        TCPSegment seg;
+        test_err_if(seg.parse(Buffer{from.segments_out().front().serialize().concatenate()}) != ParseResult::NoError,
+                    "failed to parse a segment");
+        from.segments_out().pop();
+        largest = max(largest, seg.payload().size());
+        to.segment_received(seg);
+    }
+    return largest;
+}
+
+//! Send 20000 bytes from a connection with `sender_mss` to one with `receiver_mss`
+//! \returns the largest payload the sender sent
+static size_t largest_payload(const optional<uint16_t> sender_mss, const optional<uint16_t> receiver_mss) {
+    TCPConfig sender_cfg, receiver_cfg;
+    sender_cfg.mss = sender_mss;
+    receiver_cfg.mss = receiver_mss;
+    TCPConnection x{sender_cfg}, y{receiver_cfg};
+    x.connect();
+    deliver(x, y);
+    deliver(y, x);
+
+    x.write(string(20000, 'x'));
+    size_t largest = 0;
+    for (unsigned int round = 0; y.inbound_stream().bytes_written() < 20000; round++) {
+        test_err_if(round > 100, "transfer stalled");
+        largest = max(largest, deliver(x, y));
+        deliver(y, x);
+    }
+
+    x.end_input_stream();
+    deliver(x, y);
+    y.end_input_stream();
+    deliver(y, x);
+    deliver(x, y);
+    x.tick(10 * sender_cfg.rt_timeout);
+    test_err_if(x.active() or y.active(), "connections didn't close");
+    return largest;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // a SYN gives the MSS: the configured one, or MAX_PAYLOAD_SIZE by default
+        {
+            TCPConfig cfg;
+            TCPConnection conn{cfg};
+            conn.connect();
+            test_err_if(conn.segments_out().front().header().mss != optional<uint16_t>{TCPConfig::MAX_PAYLOAD_SIZE},
+                        "test 1 failed: SYN gave " + conn.segments_out().front().header().summary());
+
+            cfg.mss = 8960;
+            TCPConnection jumbo{cfg};
+            jumbo.connect();
+            test_err_if(jumbo.segments_out().front().header().mss != optional<uint16_t>{8960},
+                        "test 1 failed: SYN gave " + jumbo.segments_out().front().header().summary());
+        }
+
+        // the sender sends segments no larger than the smaller of the two MSSs
+        {
+            test_err_if(largest_payload(8960, 8960) != 8960, "test 2 failed: didn't send jumbo segments");
+            test_err_if(largest_payload(8960, 1460) != 1460, "test 2 failed: exceeded the receiver's MSS");
+            test_err_if(largest_payload(1460, 8960) != 1460, "test 2 failed: exceeded the sender's MSS");
+            test_err_if(largest_payload({}, {}) != TCPConfig::MAX_PAYLOAD_SIZE, "test 2 failed: default MSS");
+        }
+
+        // a peer that gives no MSS is taken to accept segments as large as ours
+        {
+            TCPConfig cfg;
+            cfg.mss = 4000;
+            cfg.send_capacity = 10000;
+            TCPConnection conn{cfg};
+            conn.connect();
+            const WrappingInt32 isn = conn.segments_out().front().header().seqno;
+            conn.segments_out().pop();
+
+            TCPSegment syn_ack;
+            syn_ack.header().syn = syn_ack.header().ack = true;
+            syn_ack.header().seqno = WrappingInt32{static_cast<uint32_t>(rd())};
+            syn_ack.header().ackno = isn + 1;
+            syn_ack.header().win = 60000;
+            conn.segment_received(syn_ack);
+            while (not conn.segments_out().empty()) {
+                conn.segments_out().pop();
+            }
+
+            conn.write(string(10000, 'x'));
+            test_err_if(conn.segments_out().empty() or conn.segments_out().front().payload().size() != 4000,
+                        "test 3 failed: didn't send a full segment");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -107,6 +107,30 @@ int main() {
 
             test_3.execute(ExpectState{State::CLOSED});
         }
+
+        // test #4: start in CLOSE_WAIT, close() with data the window holds back, so the FIN rides on the data
+        {
+            TCPTestHarness test_4 = TCPTestHarness::in_close_wait(cfg);
+
+            const WrappingInt32 rx_seqno{2};
+            test_4.send_ack(rx_seqno, WrappingInt32{1}, 2);
+            test_4.execute(Write{"hello"});
+            test_4.execute(ExpectOneSegment{}.with_payload_size(2).with_seqno(WrappingInt32{1}));
+            test_4.execute(Close{});
+            test_4.execute(ExpectNoSegment{}, "test 4 failed: FIN sent past the window");
+
+            test_4.send_ack(rx_seqno, WrappingInt32{3});
+            TCPSegment seg = test_4.expect_seg(
+                ExpectOneSegment{}.with_fin(true).with_payload_size(3).with_seqno(WrappingInt32{3}),
+                "test 4 failed: the FIN didn't ride on the rest of the data");
+
+            test_4.execute(ExpectState{State::LAST_ACK});
+
+            test_4.send_ack(rx_seqno, seg.header().seqno + seg.length_in_sequence_space());
+            test_4.execute(Tick(1));
+
+            test_4.execute(ExpectState{State::CLOSED}, "test 4 failed: the ACK of a FIN riding on data went unnoticed");
+        }
     } catch (const exception &e) {
         cerr << e.what() << endl;
         return 1;
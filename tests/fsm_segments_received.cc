@@ -0,0 +1,110 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+//! \returns every segment `from` has queued, in order
+static vector<TCPSegment> drain(TCPConnection &from) {
+    vector<TCPSegment> ret;
+    for (; not from.segments_out().empty(); from.segments_out().pop()) {
+        ret.push_back(from.segments_out().front());
+    }
+    return ret;
+}
+
+//! Connect `x` to `y`, one segment at a time
+static void handshake(TCPConnection &x, TCPConnection &y) {
+    x.connect();
+    for (unsigned int round = 0; not x.segments_out().empty() or not y.segments_out().empty(); round++) {
+        test_err_if(round > 10, "handshake didn't settle");
+        for (const auto &seg : drain(x)) {
+            y.segment_received(seg);
+        }
+        for (const auto &seg : drain(y)) {
+            x.segment_received(seg);
+        }
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        string d(10 * MSS, 0);
+        generate(d.begin(), d.end(), [&] { return rd(); });
+
+        // a batch of in-order segments is answered with one ACK, for all of them
+        {
+            TCPConfig cfg;
+            TCPConnection x{cfg}, y{cfg};
+            handshake(x, y);
+            x.write(d);
+            const auto batch = drain(x);
+            test_err_if(batch.size() != 10, "test 1 failed: sent " + to_string(batch.size()) + " segments");
+
+            y.segments_received(batch);
+            const auto acks = drain(y);
+            test_err_if(acks.size() != 1, "test 1 failed: " + to_string(acks.size()) + " ACKs for one batch");
+            test_err_if(not acks[0].header().ack or
+                            acks[0].header().ackno != batch.back().header().seqno + static_cast<uint32_t>(MSS),
+                        "test 1 failed: ACK didn't cover the batch: " + acks[0].header().summary());
+            test_err_if(y.inbound_stream().read(d.size()) != d, "test 1 failed: wrong data");
+
+            for (const auto &ack : acks) {
+                x.segment_received(ack);
+            }
+            test_err_if(x.bytes_in_flight() != 0, "test 1 failed: the batch's ACK left data in flight");
+        }
+
+        // out-of-order segments in a batch get a duplicate ACK each, at once, and the data filling the gap its own
+        {
+            TCPConfig cfg;
+            TCPConnection x{cfg}, y{cfg};
+            handshake(x, y);
+            x.write(d.substr(0, 4 * MSS));
+            const auto sent = drain(x);
+            test_err_if(sent.size() != 4, "test 2 failed: sent " + to_string(sent.size()) + " segments");
+
+            y.segments_received({sent[0], sent[2], sent[3], sent[1]});
+            const auto acks = drain(y);
+            test_err_if(acks.size() != 3, "test 2 failed: " + to_string(acks.size()) + " ACKs, not 3");
+            for (size_t i = 0; i < 2; i++) {
+                test_err_if(acks[i].header().ackno != sent[1].header().seqno,
+                            "test 2 failed: no duplicate ACK for the gap: " + acks[i].header().summary());
+            }
+            test_err_if(acks[2].header().ackno != sent[3].header().seqno + static_cast<uint32_t>(MSS),
+                        "test 2 failed: no ACK for the filled gap: " + acks[2].header().summary());
+            test_err_if(y.inbound_stream().read(4 * MSS) != d.substr(0, 4 * MSS), "test 2 failed: wrong data");
+        }
+
+        // with delayed ACKs, a batch too small to ACK at once is ACKed when the delay is up
+        {
+            TCPConfig cfg;
+            cfg.ack_delay = TCPConfig::ACK_DELAY_DFLT;
+            TCPConnection x{cfg}, y{cfg};
+            handshake(x, y);
+            x.write(d.substr(0, 100));
+            y.segments_received(drain(x));
+            test_err_if(not y.segments_out().empty(), "test 3 failed: a lone segment was ACKed at once");
+            y.tick(cfg.ack_delay);
+            test_err_if(drain(y).size() != 1, "test 3 failed: no ACK when the delay was up");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
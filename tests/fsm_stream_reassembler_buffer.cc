@@ -0,0 +1,68 @@
+#include "buffer.hh"
+#include "byte_stream.hh"
+#include "fsm_stream_reassembler_harness.hh"
+#include "stream_reassembler.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ReassemblerTestHarness test{8};
+
+            // Buffers are trimmed against the window and against each other
+            test.execute(SubmitBuffer{"cdefghijkl", 2});
+            test.execute(UnassembledBytes(6));
+            test.execute(SubmitBuffer{"bcd", 1});
+            test.execute(SubmitSegment{"fg", 5});
+            test.execute(UnassembledBytes(7));
+            test.execute(SubmitBuffer{"ab", 0});
+            test.execute(BytesAssembled(8));
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(SubmitBuffer{"ghijkl", 6}.with_eof(true));
+            test.execute(BytesAvailable("ijkl"));
+            test.execute(AtEof{});
+        }
+
+        {
+            ReassemblerTestHarness test{65000};
+
+            test.execute(SubmitBuffer{"", 0});
+            test.execute(SubmitBuffer{"ef", 4});
+            test.execute(SubmitBuffer{"bcdefg", 1});
+            test.execute(UnassembledBytes(6));
+            test.execute(SubmitBuffer{"a", 0}.with_eof(false));
+            test.execute(SubmitBuffer{"", 7}.with_eof(true));
+            test.execute(BytesAvailable("abcdefg"));
+            test.execute(AtEof{});
+        }
+
+        // with a chunked output stream, pushed Buffers reach the reader without a copy
+        {
+            StreamReassembler reassembler{64, StreamReassembler::Storage::Map, ByteStream::Storage::Chunked};
+            const Buffer later{"world"};
+            const Buffer first{"hello "};
+            reassembler.push_substring(later, 6, true);
+            reassembler.push_substring(first, 0, false);
+
+            const BufferList out = reassembler.stream_out().peek_buffers(11);
+            if (out.buffers().size() != 2 or out.buffers().at(0).str().data() != first.str().data() or
+                out.buffers().at(1).str().data() != later.str().data()) {
+                throw runtime_error("reassembled Buffers were copied");
+            }
+            if (out.concatenate() != "hello world" or not reassembler.stream_out().input_ended()) {
+                throw runtime_error("wrong reassembled stream");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 class ReassemblerExpectationViolation : public std::runtime_error {
   public:
@@ -103,6 +104,36 @@ struct UnassembledBytes : public ReassemblerExpectation {
     }
 };
 
+struct HeldRanges : public ReassemblerExpectation {
+    std::vector<std::pair<uint64_t, uint64_t>> _ranges;
+    size_t _max_blocks;
+
+    HeldRanges(std::vector<std::pair<uint64_t, uint64_t>> ranges, size_t max_blocks = 4)
+        : _ranges(std::move(ranges)), _max_blocks(max_blocks) {}
+
+    static std::string format(const std::vector<std::pair<uint64_t, uint64_t>> &ranges) {
+        std::ostringstream ss;
+        for (const auto &[start, end] : ranges) {
+            ss << "[" << start << ", " << end << ") ";
+        }
+        return ss.str();
+    }
+
+    std::string description() const {
+        return "held_ranges(" + std::to_string(_max_blocks) + ") = " + format(_ranges);
+    }
+
+    void execute(StreamReassembler &reassembler) const {
+        const auto actual = reassembler.held_ranges(_max_blocks);
+        if (actual != _ranges) {
+            std::ostringstream ss;
+            ss << "The reassembler was expected to hold ranges `" << format(_ranges) << "`, but held `"
+               << format(actual) << "`";
+            throw ReassemblerExpectationViolation(ss.str());
+        }
+    }
+};
+
 struct AtEof : public ReassemblerExpectation {
     AtEof() {}
     std::string description() const {
@@ -159,12 +190,30 @@ struct SubmitSegment : public ReassemblerAction {
     void execute(StreamReassembler &reassembler) const { reassembler.push_substring(_data, _index, _eof); }
 };
 
+//! Like SubmitSegment, but through the push_substring(Buffer, ...) overload
+struct SubmitBuffer : public SubmitSegment {
+    using SubmitSegment::SubmitSegment;
+
+    SubmitBuffer &with_eof(bool eof) {
+        _eof = eof;
+        return *this;
+    }
+
+    std::string description() const { return "Buffer " + SubmitSegment::description(); }
+
+    void execute(StreamReassembler &reassembler) const {
+        reassembler.push_substring(Buffer(std::string(_data)), _index, _eof);
+    }
+};
+
 class ReassemblerTestHarness {
     StreamReassembler reassembler;
     std::vector<std::string> steps_executed;
 
   public:
-    ReassemblerTestHarness(const size_t capacity) : reassembler(capacity), steps_executed() {
+    ReassemblerTestHarness(const size_t capacity,
+                           const StreamReassembler::Storage storage = StreamReassembler::Storage::Map)
+        : reassembler(capacity, storage), steps_executed() {
         steps_executed.emplace_back("Initialized (capacity = " + std::to_string(capacity) + ")");
     }
 
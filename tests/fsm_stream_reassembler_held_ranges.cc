@@ -0,0 +1,63 @@
+#include "byte_stream.hh"
+#include "fsm_stream_reassembler_harness.hh"
+#include "stream_reassembler.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ReassemblerTestHarness test{65000};
+
+            test.execute(HeldRanges({}));
+            test.execute(SubmitSegment{"a", 0});
+            test.execute(HeldRanges({}));
+
+            // most recently pushed-to range first
+            test.execute(SubmitSegment{"cd", 2});
+            test.execute(SubmitSegment{"gh", 6});
+            test.execute(SubmitSegment{"kl", 10});
+            test.execute(HeldRanges({{10, 12}, {6, 8}, {2, 4}}));
+            test.execute(HeldRanges({{10, 12}, {6, 8}}, 2));
+
+            // a duplicate moves its range to the front
+            test.execute(SubmitSegment{"c", 2});
+            test.execute(HeldRanges({{2, 4}, {10, 12}, {6, 8}}));
+
+            // extending and bridging ranges merges them
+            test.execute(SubmitSegment{"i", 8});
+            test.execute(HeldRanges({{6, 9}, {2, 4}, {10, 12}}));
+            test.execute(SubmitSegment{"j", 9});
+            test.execute(HeldRanges({{6, 12}, {2, 4}}));
+            test.execute(SubmitSegment{"def", 3});
+            test.execute(HeldRanges({{2, 12}}));
+            test.execute(UnassembledBytes(10));
+
+            // assembling removes the range
+            test.execute(SubmitSegment{"b", 1});
+            test.execute(HeldRanges({}));
+            test.execute(BytesAvailable("abcdefghijkl"));
+        }
+
+        {
+            ReassemblerTestHarness test{8};
+
+            // only the part inside the window is held
+            test.execute(SubmitSegment{"cdefghijkl", 2});
+            test.execute(HeldRanges({{2, 8}}));
+            test.execute(SubmitSegment{"ab", 0});
+            test.execute(HeldRanges({}));
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(SubmitSegment{"k", 10});
+            test.execute(HeldRanges({{10, 11}}));
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
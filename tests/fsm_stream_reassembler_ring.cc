@@ -0,0 +1,226 @@
+#include "byte_stream.hh"
+#include "fsm_stream_reassembler_harness.hh"
+#include "stream_reassembler.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned NREPS = 32;
+static constexpr unsigned NSEGS = 128;
+static constexpr unsigned MAX_SEG_LEN = 2048;
+
+static constexpr auto RING = StreamReassembler::Storage::Ring;
+
+// count heap allocations, to check that a Ring reassembler makes none after construction
+static size_t allocations = 0;
+
+void *operator new(const size_t size) {
+    ++allocations;
+    if (void *ptr = malloc(size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+string read(StreamReassembler &reassembler) {
+    return reassembler.stream_out().read(reassembler.stream_out().buffer_size());
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // holes, duplicates and overlaps, as with Storage::Map
+        {
+            ReassemblerTestHarness test{65000, RING};
+
+            test.execute(SubmitSegment{"b", 1});
+            test.execute(SubmitSegment{"d", 3});
+            test.execute(SubmitSegment{"bcd", 1});
+            test.execute(UnassembledBytes(3));
+            test.execute(BytesAssembled(0));
+            test.execute(SubmitSegment{"a", 0});
+            test.execute(BytesAssembled(4));
+            test.execute(UnassembledBytes(0));
+            test.execute(SubmitSegment{"abcdefgh", 0}.with_eof(true));
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(AtEof{});
+        }
+
+        // only the window is kept, and the slots read out are reused as the ring wraps around
+        {
+            ReassemblerTestHarness test{8, RING};
+
+            test.execute(SubmitSegment{"cdefghijkl", 2});
+            test.execute(UnassembledBytes(6));
+            test.execute(SubmitSegment{"ab", 0});
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(SubmitSegment{"mnopqrst", 12});
+            test.execute(SubmitSegment{"ijkl", 8});
+            test.execute(UnassembledBytes(0));
+            test.execute(BytesAvailable("ijklmnop"));
+            test.execute(SubmitSegment{"uvwx", 20}.with_eof(true));
+            test.execute(SubmitSegment{"qrst", 16});
+            test.execute(BytesAvailable("qrstuvwx"));
+            test.execute(AtEof{});
+        }
+
+        // Buffers are copied into the ring
+        {
+            ReassemblerTestHarness test{8, RING};
+
+            test.execute(SubmitBuffer{"cdefghijkl", 2});
+            test.execute(SubmitBuffer{"bcd", 1});
+            test.execute(UnassembledBytes(7));
+            test.execute(SubmitBuffer{"ab", 0});
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(SubmitBuffer{"ghijkl", 6}.with_eof(true));
+            test.execute(BytesAvailable("ijkl"));
+            test.execute(AtEof{});
+        }
+
+        // held ranges, most recently pushed-to first
+        {
+            ReassemblerTestHarness test{65000, RING};
+
+            test.execute(SubmitSegment{"cd", 2});
+            test.execute(SubmitSegment{"gh", 6});
+            test.execute(SubmitSegment{"kl", 10});
+            test.execute(HeldRanges({{10, 12}, {6, 8}, {2, 4}}));
+            test.execute(SubmitSegment{"c", 2});
+            test.execute(HeldRanges({{2, 4}, {10, 12}, {6, 8}}));
+            test.execute(SubmitSegment{"ij", 8});
+            test.execute(HeldRanges({{6, 12}, {2, 4}}));
+            test.execute(SubmitSegment{"ab", 0});
+            test.execute(HeldRanges({{6, 12}}));
+            test.execute(SubmitSegment{"ef", 4});
+            test.execute(HeldRanges({}));
+            test.execute(BytesAvailable("abcdefghijkl"));
+        }
+
+        // only the 4 most recent ranges are remembered, and a range keeps its recency as it grows and wraps
+        {
+            ReassemblerTestHarness test{16, RING};
+
+            test.execute(SubmitSegment{"abcdefgh", 0});
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(SubmitSegment{"k", 10});
+            test.execute(SubmitSegment{"m", 12});
+            test.execute(SubmitSegment{"o", 14});
+            test.execute(SubmitSegment{"q", 16});
+            test.execute(SubmitSegment{"s", 18});
+            test.execute(HeldRanges({{18, 19}, {16, 17}, {14, 15}, {12, 13}}));
+            test.execute(SubmitSegment{"tuv", 19});
+            test.execute(SubmitSegment{"n", 13});
+            test.execute(HeldRanges({{12, 15}, {18, 22}, {16, 17}}));
+            test.execute(SubmitSegment{"r", 17});
+            test.execute(HeldRanges({{16, 22}, {12, 15}}));
+            test.execute(SubmitSegment{"ij", 8});
+            test.execute(BytesAvailable("ijk"));
+            test.execute(HeldRanges({{16, 22}, {12, 15}}));
+            test.execute(SubmitSegment{"lmnop", 11});
+            test.execute(HeldRanges({}));
+            test.execute(BytesAvailable("lmnopqrstuv"));
+        }
+
+        // pushing, assembling and finding held ranges don't allocate
+        {
+            StreamReassembler buf{1000, RING};
+            vector<pair<string, size_t>> segs;
+            for (size_t off = 0; off < 20000; off += 100) {
+                segs.emplace_back(string(100, 'a' + off / 100 % 26), off);
+            }
+
+            for (size_t window_start = 0; window_start < segs.size(); window_start += 10) {
+                const size_t before = allocations;
+                for (size_t i = window_start + 10; i > window_start; i--) {
+                    buf.push_substring(segs[i - 1].first, segs[i - 1].second, false);
+                    if (i > window_start + 1 and buf.held_ranges(4).size() != 1) {
+                        throw runtime_error("allocation-free ring - wrong held ranges");
+                    }
+                }
+                // less one for each vector held_ranges() returned
+                if (allocations - before != 9) {
+                    throw runtime_error("allocation-free ring - " + to_string(allocations - before - 9) +
+                                        " allocations");
+                }
+                buf.stream_out().pop_output(buf.stream_out().buffer_size());
+            }
+        }
+
+        // shuffled segments
+        for (unsigned rep_no = 0; rep_no < NREPS; ++rep_no) {
+            StreamReassembler buf{MAX_SEG_LEN * NSEGS, RING};
+
+            vector<tuple<size_t, size_t>> seq_size;
+            size_t offset = 0;
+            for (unsigned i = 0; i < NSEGS; ++i) {
+                const size_t size = 1 + (rd() % (MAX_SEG_LEN - 1));
+                const size_t offs = min(offset, 1 + (static_cast<size_t>(rd()) % 1023));
+                seq_size.emplace_back(offset - offs, size + offs);
+                offset += size;
+            }
+            shuffle(seq_size.begin(), seq_size.end(), rd);
+
+            string d(offset, 0);
+            generate(d.begin(), d.end(), [&] { return rd(); });
+
+            for (auto [off, sz] : seq_size) {
+                buf.push_substring(d.substr(off, sz), off, off + sz == offset);
+            }
+
+            const auto result = read(buf);
+            if (buf.stream_out().bytes_written() != offset or result != d or not buf.stream_out().eof()) {
+                throw runtime_error("shuffled segments - wrong reassembled stream");
+            }
+        }
+
+        // a stream many times the capacity, shuffled a window at a time and read as it goes
+        for (unsigned rep_no = 0; rep_no < NREPS; ++rep_no) {
+            const size_t capacity = 1000 + rd() % 1000;
+            StreamReassembler buf{capacity, RING};
+
+            string d(50 * capacity, 0);
+            generate(d.begin(), d.end(), [&] { return rd(); });
+
+            string result;
+            for (size_t window_start = 0; window_start < d.size(); window_start += capacity) {
+                vector<pair<size_t, size_t>> segs;
+                for (size_t off = window_start; off < min(d.size(), window_start + capacity);) {
+                    const size_t size = min(1 + rd() % 100, d.size() - off);
+                    segs.emplace_back(off, size);
+                    off += size;
+                }
+                shuffle(segs.begin(), segs.end(), rd);
+                for (auto [off, sz] : segs) {
+                    buf.push_substring(d.substr(off, sz), off, off + sz == d.size());
+                }
+                result += read(buf);
+            }
+
+            if (result != d or not buf.stream_out().eof() or not buf.empty()) {
+                throw runtime_error("ring wrap-around - wrong reassembled stream");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+static constexpr size_t CAPACITY = 4'000'000;  // advertised with a shift of 6
+
+//! Deliver every segment `from` has queued to `to`, serialized and parsed as if on the wire
+static void deliver(TCPConnection &from, TCPConnection &to) {
+    while (not from.segments_out().empty()) {
+        TCPSegment seg;
+        if (seg.parse(Buffer{from.segments_out().front().serialize().concatenate()}) != ParseResult::NoError) {
+            throw runtime_error("failed to parse a segment: " + from.segments_out().front().header().summary());
+        }
+        from.segments_out().pop();
+        to.segment_received(seg);
+    }
+}
+
+//! Transfer `size` bytes from one connection to the other
+//! \returns the most bytes the sender had in flight at once
+static size_t transfer(const TCPConfig &sender_cfg, const TCPConfig &receiver_cfg, const size_t size) {
+    TCPConnection x{sender_cfg}, y{receiver_cfg};
+    x.connect();
+
+    const string chunk(sender_cfg.send_capacity, 'x');
+    size_t written = 0;
+    size_t received = 0;
+    size_t max_in_flight = 0;
+    for (unsigned int round = 0; received < size; round++) {
+        test_err_if(round > 1000, "transfer stalled after " + to_string(received) + " bytes");
+        if (written < size) {
+            written += x.write(chunk.substr(0, min(size - written, x.remaining_outbound_capacity())));
+        }
+        max_in_flight = max(max_in_flight, x.bytes_in_flight());
+        deliver(x, y);
+        received += y.inbound_stream().read(y.inbound_stream().buffer_size()).size();
+        deliver(y, x);
+    }
+
+    x.end_input_stream();
+    deliver(x, y);
+    y.end_input_stream();
+    deliver(y, x);
+    deliver(x, y);
+    x.tick(10 * sender_cfg.rt_timeout);
+    test_err_if(x.active() or y.active(), "connections didn't close");
+    return max_in_flight;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.recv_capacity = CAPACITY;
+        cfg.send_capacity = CAPACITY;
+
+        // a SYN offers the shift that fits the receive capacity in 16 bits
+        {
+            TCPTestHarness test_1(cfg);
+            test_1.execute(Connect{});
+            const TCPSegment syn = test_1.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(false),
+                                                     "test 1 failed: no SYN after connect()");
+            test_err_if(syn.header().window_scale != optional<uint8_t>{6},
+                        "test 1 failed: SYN offered " + syn.header().summary());
+        }
+
+        // a peer that doesn't offer window scaling sees the largest unscaled window, not a truncated one
+        {
+            const WrappingInt32 seq_base(rd());
+            TCPTestHarness test_2(cfg);
+            test_2.execute(Listen{});
+            test_2.send_syn(seq_base);
+            const TCPSegment syn_ack = test_2.expect_seg(
+                ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(seq_base + 1).with_win(65535),
+                "test 2 failed: SYN/ACK invalid");
+            test_err_if(syn_ack.header().window_scale.has_value(),
+                        "test 2 failed: SYN/ACK offered window scaling the peer didn't");
+
+            test_2.send_ack(seq_base + 1, syn_ack.header().seqno + 1, 1000);
+            test_2.execute(ExpectState{State::ESTABLISHED});
+            test_2.send_byte(seq_base + 1, syn_ack.header().seqno + 1, 'x');
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(seq_base + 2).with_win(65535),
+                           "test 2 failed: ACK invalid");
+        }
+
+        // end to end, with both sides scaling, the sender fills a window of megabytes
+        {
+            const size_t max_in_flight = transfer(cfg, cfg, 4 * CAPACITY);
+            test_err_if(max_in_flight < CAPACITY / 2 or max_in_flight > CAPACITY,
+                        "test 3 failed: " + to_string(max_in_flight) + " bytes in flight at most");
+        }
+
+        // ... but if either side doesn't offer it, windows stay within 16 bits
+        {
+            TCPConfig unscaled = cfg;
+            unscaled.window_scaling = false;
+            test_err_if(transfer(cfg, unscaled, CAPACITY) > 65535,
+                        "test 4 failed: scaled without the receiver offering it");
+            test_err_if(transfer(unscaled, cfg, CAPACITY) > 65535,
+                        "test 4 failed: scaled without the sender offering it");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -13,6 +13,8 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct ReceiverTestStep {
     virtual std::string to_string() const { return "ReceiverTestStep"; }
@@ -140,6 +142,30 @@ struct ExpectInputNotEnded : public ReceiverExpectation {
     }
 };
 
+struct ExpectSackBlocks : public ReceiverExpectation {
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> _blocks;
+
+    ExpectSackBlocks(std::vector<std::pair<WrappingInt32, WrappingInt32>> blocks) : _blocks(std::move(blocks)) {}
+
+    static std::string blocks_string(const std::vector<std::pair<WrappingInt32, WrappingInt32>> &blocks) {
+        std::ostringstream ss;
+        for (const auto &[left, right] : blocks) {
+            ss << "[" << left << ", " << right << ") ";
+        }
+        return ss.str();
+    }
+
+    std::string description() const { return "SACK blocks " + blocks_string(_blocks); }
+
+    void execute(TCPReceiver &receiver) const {
+        const auto blocks = receiver.sack_blocks(TCPHeader::MAX_SACK_BLOCKS);
+        if (blocks != _blocks) {
+            throw ReceiverExpectationViolation("The TCPReceiver reported SACK blocks `" + blocks_string(blocks) +
+                                               "`, but they were expected to be `" + blocks_string(_blocks) + "`");
+        }
+    }
+};
+
 struct ExpectBytes : public ReceiverExpectation {
     std::string _bytes;
 
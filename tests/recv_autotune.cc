@@ -0,0 +1,112 @@
+#include "tcp_receiver.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t CAPACITY = 64000;
+static constexpr size_t INITIAL_WINDOW = 4000;
+static constexpr size_t RTT_MS = 10;
+
+//! A peer sending into a TCPReceiver, a segment of up to 1000 bytes at a time
+struct Peer {
+    WrappingInt32 isn;
+    uint64_t sent{0};
+
+    void syn(TCPReceiver &receiver) const {
+        TCPSegment seg;
+        seg.header().syn = true;
+        seg.header().seqno = isn;
+        receiver.segment_received(seg);
+    }
+
+    //! Send `len` bytes
+    void send(TCPReceiver &receiver, const size_t len) {
+        for (size_t done = 0; done < len;) {
+            TCPSegment seg;
+            seg.header().seqno = isn + 1 + static_cast<uint32_t>(sent);
+            seg.payload() = string(min<size_t>(1000, len - done), 'x');
+            receiver.segment_received(seg);
+            done += seg.payload().size();
+            sent += seg.payload().size();
+        }
+    }
+};
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // with a reader that keeps up, the window doubles each round trip, up to the capacity
+        {
+            TCPReceiver receiver{CAPACITY, INITIAL_WINDOW};
+            Peer peer{WrappingInt32{static_cast<uint32_t>(rd())}};
+            peer.syn(receiver);
+            test_err_if(receiver.window_size() != INITIAL_WINDOW or receiver.committed_bytes() != 0,
+                        "test 1 failed: didn't start at the initial window, with nothing allocated");
+
+            size_t window = receiver.window_size();
+            for (unsigned int round = 0; round < 10; round++) {
+                // the peer fills the window it last heard of, and the reader consumes it all
+                peer.send(receiver, window);
+                test_err_if(receiver.committed_bytes() > CAPACITY, "test 1 failed: committed beyond the capacity");
+                receiver.stream_out().read(receiver.stream_out().buffer_size());
+                receiver.tick(RTT_MS);
+
+                const size_t grown = receiver.window_size();
+                test_err_if(grown < window or grown > max(2 * window, INITIAL_WINDOW),
+                            "test 1 failed: window went from " + to_string(window) + " to " + to_string(grown));
+                window = grown;
+            }
+            test_err_if(window != CAPACITY, "test 1 failed: window grew only to " + to_string(window));
+            test_err_if(receiver.committed_bytes() != 0, "test 1 failed: memory still committed once all was read");
+
+            // and once the peer goes quiet, it falls back
+            receiver.tick(TCPReceiver::IDLE_MS);
+            test_err_if(receiver.window_size() != INITIAL_WINDOW,
+                        "test 1 failed: idle window " + to_string(receiver.window_size()));
+        }
+
+        // with a reader that doesn't keep up, it doesn't grow
+        {
+            TCPReceiver receiver{CAPACITY, INITIAL_WINDOW};
+            Peer peer{WrappingInt32{static_cast<uint32_t>(rd())}};
+            peer.syn(receiver);
+            for (unsigned int round = 0; round < 10; round++) {
+                peer.send(receiver, receiver.window_size());
+                receiver.stream_out().read(100);
+                receiver.tick(RTT_MS);
+            }
+            test_err_if(receiver.window_size() + receiver.stream_out().buffer_size() != INITIAL_WINDOW,
+                        "test 2 failed: window grew to " + to_string(receiver.window_size()));
+            test_err_if(receiver.committed_bytes() > INITIAL_WINDOW,
+                        "test 2 failed: committed " + to_string(receiver.committed_bytes()) + " bytes");
+        }
+
+        // without an initial window, the window is the capacity, less what's buffered
+        {
+            TCPReceiver receiver{CAPACITY};
+            Peer peer{WrappingInt32{static_cast<uint32_t>(rd())}};
+            peer.syn(receiver);
+            peer.send(receiver, 3000);
+            receiver.tick(TCPReceiver::IDLE_MS);
+            test_err_if(receiver.window_size() != CAPACITY - 3000 or receiver.committed_bytes() != 3000,
+                        "test 3 failed: window " + to_string(receiver.window_size()));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "buffer.hh"
+#include "parser.hh"
+#include "tcp_receiver.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+static constexpr size_t CAPACITY = 64000;
+static constexpr size_t SEGMENT_SIZE = 1000;
+static constexpr size_t READ_SIZE = 1024 * 1024;  // what FileDescriptor::read() sizes its string for
+
+//! \returns the process's resident set size now, in KiB
+static long current_rss_kib() {
+    long pages = 0, resident = 0;
+    ifstream statm{"/proc/self/statm"};
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//! \returns `seg` parsed back from a string allocated for a much larger read, as an adapter receives it
+static TCPSegment received(const TCPSegment &seg) {
+    const string wire = seg.serialize().concatenate();
+    string datagram(READ_SIZE, 0);
+    datagram.replace(0, wire.size(), wire);
+    datagram.resize(wire.size());  // keeps the capacity
+
+    TCPSegment ret;
+    if (ret.parse(Buffer(move(datagram))) != ParseResult::NoError) {
+        throw runtime_error("couldn't parse the segment back");
+    }
+    return ret;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const WrappingInt32 isn{static_cast<uint32_t>(rd())};
+
+        TCPReceiver receiver{CAPACITY};
+        {
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = isn;
+            receiver.segment_received(received(syn));
+        }
+
+        // fill the window, the first half in order (held in the stream, unread) and the rest past a hole
+        // (held by the reassembler), from datagrams that each came in a 1 MiB allocation
+        const long rss_before_kib = current_rss_kib();
+        const size_t segments = CAPACITY / SEGMENT_SIZE;
+        for (size_t i = 0; i < segments; i++) {
+            if (i == segments / 2) {
+                continue;
+            }
+            TCPSegment seg;
+            seg.header().seqno = isn + 1 + static_cast<uint32_t>(i * SEGMENT_SIZE);
+            seg.payload() = string(SEGMENT_SIZE, 'a' + i % 26);
+            receiver.segment_received(received(seg));
+        }
+        const long growth_kib = current_rss_kib() - rss_before_kib;
+
+        test_err_if(receiver.stream_out().buffer_size() != CAPACITY / 2 or
+                        receiver.unassembled_bytes() != CAPACITY / 2 - SEGMENT_SIZE,
+                    "test 1 failed: didn't hold the window");
+        // holding the slices would keep every datagram's allocation, some 60 MiB; allow for the allocator
+        // keeping a few freed ones around
+        test_err_if(growth_kib * 1024 > static_cast<long>(4 * READ_SIZE),
+                    "test 1 failed: resident memory grew by " + to_string(growth_kib) + " KiB to hold " +
+                        to_string(CAPACITY) + " bytes");
+
+        // and what it reports committing is what its payloads' allocations add up to
+        const size_t held = receiver.stream_out().buffer_size() + receiver.unassembled_bytes();
+        test_err_if(receiver.committed_bytes() < held or
+                        receiver.committed_bytes() > TCPReceiver::MAX_PINNED_RATIO * held,
+                    "test 1 failed: reported " + to_string(receiver.committed_bytes()) + " bytes committed to hold " +
+                        to_string(held));
+        receiver.stream_out().pop_output(receiver.stream_out().buffer_size());
+        test_err_if(receiver.committed_bytes() != receiver.unassembled_bytes(),
+                    "test 1 failed: reported " + to_string(receiver.committed_bytes()) + " bytes committed once read");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
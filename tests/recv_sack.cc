@@ -0,0 +1,67 @@
+#include "receiver_harness.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // SACK blocks cover the out-of-order data, most recently received first
+        {
+            uint32_t isn = uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+            TCPReceiverTestHarness test{4000};
+            test.execute(ExpectSackBlocks{{}});
+            test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+            test.execute(ExpectSackBlocks{{}});
+
+            test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("efgh"));
+            test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 5}, WrappingInt32{isn + 9}}}});
+
+            test.execute(SegmentArrives{}.with_seqno(isn + 13).with_data("mnop"));
+            test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 13}, WrappingInt32{isn + 17}},
+                                           {WrappingInt32{isn + 5}, WrappingInt32{isn + 9}}}});
+
+            // extending a block makes it the most recent
+            test.execute(SegmentArrives{}.with_seqno(isn + 9).with_data("ij"));
+            test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 5}, WrappingInt32{isn + 11}},
+                                           {WrappingInt32{isn + 13}, WrappingInt32{isn + 17}}}});
+
+            // the cumulative ack overtakes the first block
+            test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+            test.execute(ExpectAckno{WrappingInt32{isn + 11}});
+            test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 13}, WrappingInt32{isn + 17}}}});
+
+            test.execute(SegmentArrives{}.with_seqno(isn + 11).with_data("kl"));
+            test.execute(ExpectAckno{WrappingInt32{isn + 17}});
+            test.execute(ExpectSackBlocks{{}});
+        }
+
+        // at most four blocks
+        {
+            uint32_t isn = uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+            TCPReceiverTestHarness test{4000};
+            test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+            for (uint32_t i = 1; i <= 5; i++) {
+                test.execute(SegmentArrives{}.with_seqno(isn + 1 + 10 * i).with_data("x"));
+            }
+            test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 51}, WrappingInt32{isn + 52}},
+                                           {WrappingInt32{isn + 41}, WrappingInt32{isn + 42}},
+                                           {WrappingInt32{isn + 31}, WrappingInt32{isn + 32}},
+                                           {WrappingInt32{isn + 21}, WrappingInt32{isn + 22}}}});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
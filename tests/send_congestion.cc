@@ -0,0 +1,149 @@
+#include "congestion_controller.hh"
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//! Acknowledge a full window of MSS-sized segments, spread evenly over one RTT
+static void ack_one_rtt(CongestionController &cc, size_t &now, const size_t rtt) {
+    const size_t segments = cc.cwnd() / TCPConfig::MAX_PAYLOAD_SIZE;
+    for (size_t i = 0; i < segments; i++) {
+        cc.on_ack(TCPConfig::MAX_PAYLOAD_SIZE, now + i * rtt / segments, rtt);
+    }
+    now += rtt;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = TCPConfig::CongestionControl::NewReno;
+
+            TCPSenderTestHarness test{"Congestion window limits bytes in flight", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            // RFC 6928 initial window; the SYN doesn't grow it
+            test.execute(ExpectCwnd{10000});
+
+            test.execute(WriteBytes{string(20000, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{10000});
+
+            // slow start: each ack of a full segment opens the window by one more
+            test.execute(AckReceived{WrappingInt32{isn + 1001}}.with_win(60000));
+            test.execute(ExpectCwnd{11000});
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 10001));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 11001));
+            test.execute(ExpectNoSegment{});
+
+            // the receiver's window still applies
+            test.execute(AckReceived{WrappingInt32{isn + 2001}}.with_win(10000));
+            test.execute(ExpectCwnd{12000});
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{10000});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.congestion_control = TCPConfig::CongestionControl::NewReno;
+
+            TCPSenderTestHarness test{"Timeout collapses the congestion window", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(20000, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+            }
+
+            test.execute(Tick{1000});
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1));
+            test.execute(ExpectCwnd{1000});
+            test.execute(ExpectNoSegment{});
+
+            // everything arrives; slow start resumes from one segment
+            test.execute(AckReceived{WrappingInt32{isn + 10001}}.with_win(60000));
+            test.execute(ExpectCwnd{2000});
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 10001));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 11001));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            NewReno reno{1000};
+            reno.on_loss(20000, 0);
+            if (reno.cwnd() != 10000 or reno.ssthresh() != 10000) {
+                throw runtime_error("NewReno: a loss should halve the window");
+            }
+
+            // congestion avoidance: one segment per window of acked bytes
+            for (unsigned int i = 0; i < 9; i++) {
+                reno.on_ack(1000, 0, {});
+            }
+            if (reno.cwnd() != 10000) {
+                throw runtime_error("NewReno: grew before a window was acked");
+            }
+            reno.on_ack(1000, 0, {});
+            if (reno.cwnd() != 11000) {
+                throw runtime_error("NewReno: didn't grow after a window was acked");
+            }
+        }
+
+        {
+            constexpr size_t rtt = 200;
+            Cubic cubic{1000};
+            size_t now = 0;
+            while (cubic.cwnd() < 100000) {
+                cubic.on_ack(1000, now, rtt);
+            }
+            cubic.on_loss(100000, now);
+            if (cubic.cwnd() != 70000) {
+                throw runtime_error("CUBIC: a loss should reduce the window to 0.7 of itself");
+            }
+
+            // K = cbrt(100 * 0.3 / 0.4) seconds, about 21 RTTs: the window climbs quickly and then
+            // more slowly back to 100 segments (concave), then probes beyond it ever faster (convex)
+            for (unsigned int i = 0; i < 10; i++) {
+                ack_one_rtt(cubic, now, rtt);
+            }
+            if (cubic.cwnd() < 90000 or cubic.cwnd() > 100000) {
+                throw runtime_error("CUBIC: window is " + to_string(cubic.cwnd()) + " bytes at K/2");
+            }
+
+            for (unsigned int i = 0; i < 11; i++) {
+                ack_one_rtt(cubic, now, rtt);
+            }
+            if (cubic.cwnd() < 99000 or cubic.cwnd() > 102000) {
+                throw runtime_error("CUBIC: window is " + to_string(cubic.cwnd()) + " bytes at K");
+            }
+
+            for (unsigned int i = 0; i < 20; i++) {
+                ack_one_rtt(cubic, now, rtt);
+            }
+            if (cubic.cwnd() < 115000) {
+                throw runtime_error("CUBIC: window is only " + to_string(cubic.cwnd()) + " bytes 4 s after K");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Third duplicate ACK triggers a retransmission", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(5000, 'x')});
+            for (unsigned int i = 0; i < 5; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+            }
+
+            test.execute(AckReceived{WrappingInt32{isn + 1001}}.with_win(60000));
+            test.execute(AckReceived{WrappingInt32{isn + 1001}}.with_win(60000));
+            test.execute(AckReceived{WrappingInt32{isn + 1001}}.with_win(60000));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1001}}.with_win(60000));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1001));
+            test.execute(ExpectNoSegment{});
+
+            // more duplicates don't resend it again
+            test.execute(AckReceived{WrappingInt32{isn + 1001}}.with_win(60000));
+            test.execute(ExpectNoSegment{});
+
+            // a partial ACK means the next segment was lost too
+            test.execute(AckReceived{WrappingInt32{isn + 2001}}.with_win(60000));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 2001));
+            test.execute(ExpectNoSegment{});
+
+            // the full ACK ends recovery
+            test.execute(AckReceived{WrappingInt32{isn + 5001}}.with_win(60000));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"A window update is not a duplicate ACK", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(3000, 'x')});
+            for (unsigned int i = 0; i < 3; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+            }
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(59000));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(58000));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(57000));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(56000));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = TCPConfig::CongestionControl::NewReno;
+
+            TCPSenderTestHarness test{"Fast recovery halves and inflates the congestion window", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(20000, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+            }
+
+            // the first segment is lost; the next three arrive
+            for (unsigned int i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            }
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectCwnd{5000});
+
+            // cwnd is inflated to ssthresh + 3 segments, and each further duplicate adds one; new
+            // data goes out once the inflated window exceeds the 10 segments still in flight
+            for (unsigned int i = 0; i < 2; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+                test.execute(ExpectNoSegment{});
+            }
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 10001));
+            test.execute(ExpectNoSegment{});
+
+            // the full ACK deflates the window back to ssthresh
+            test.execute(AckReceived{WrappingInt32{isn + 10001}}.with_win(60000));
+            test.execute(ExpectCwnd{5000});
+            for (unsigned int i = 0; i < 4; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 11001 + 1000 * i));
+            }
+            test.execute(ExpectNoSegment{});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
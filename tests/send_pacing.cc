@@ -0,0 +1,111 @@
+#include "tcp_config.hh"
+#include "tcp_sender.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr uint64_t STEP_US = 50;  // resolution of the simulated clock
+
+//! Open a sender's connection, with `rtt` ms for the SYN's round trip, and have it send `bytes`
+static TCPSender established_sender(const TCPConfig &cfg, const size_t rtt, const size_t bytes) {
+    TCPSender sender{cfg};
+    sender.fill_window();
+    sender.segments_out().pop();
+    sender.tick(rtt);
+    sender.ack_received(cfg.fixed_isn.value() + 1, 60000);
+    sender.stream_in().write(string(bytes, 'x'));
+    sender.fill_window();
+    return sender;
+}
+
+//! \returns the times (in microseconds from now) that `sender` sends each segment in the next `duration_us`
+static vector<uint64_t> send_times(TCPSender &sender, const uint64_t duration_us) {
+    vector<uint64_t> ret;
+    for (uint64_t now = 0; now < duration_us; now += STEP_US) {
+        while (not sender.segments_out().empty()) {
+            ret.push_back(now);
+            sender.segments_out().pop();
+        }
+        sender.tick_us(STEP_US);
+    }
+    return ret;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // slow start paces at 2 * cwnd / SRTT: 2 * 10000 bytes / 100 ms, so a 1000-byte segment every 5 ms
+        {
+            TCPConfig cfg;
+            cfg.fixed_isn = WrappingInt32{static_cast<uint32_t>(rd())};
+            cfg.congestion_control = TCPConfig::CongestionControl::NewReno;
+            cfg.pacing = true;
+            TCPSender sender = established_sender(cfg, 100, 10000);
+
+            if (sender.pacing_rate() != optional<double>{200} or sender.pacing_delay_us() != optional<uint64_t>{5000}) {
+                throw runtime_error("the pacer should wait 5 ms after the first segment");
+            }
+            const auto times = send_times(sender, 100'000);
+            if (times.size() != 10) {
+                throw runtime_error("paced sender sent " + to_string(times.size()) + " segments, not 10");
+            }
+            for (size_t i = 1; i < times.size(); i++) {
+                const uint64_t gap = times[i] - times[i - 1];
+                if (gap < 5000 or gap > 5000 + STEP_US) {
+                    throw runtime_error("gap of " + to_string(gap) + " us between paced segments " + to_string(i - 1) +
+                                        " and " + to_string(i));
+                }
+            }
+            if (sender.pacing_delay_us().has_value()) {
+                throw runtime_error("the pacer has nothing left to hold back");
+            }
+        }
+
+        // ticks coarser than the gap release what has come due, and no more
+        {
+            TCPConfig cfg;
+            cfg.fixed_isn = WrappingInt32{static_cast<uint32_t>(rd())};
+            cfg.pacing = true;
+            // no congestion control: the receiver's window, spread over SRTT (60000 bytes / 10 ms)
+            TCPSender sender = established_sender(cfg, 10, 20000);
+            sender.segments_out().pop();
+
+            sender.tick(1);
+            size_t sent = 0;
+            for (; not sender.segments_out().empty(); sender.segments_out().pop()) {
+                sent++;
+            }
+            if (sent != 6) {
+                throw runtime_error("a 1 ms tick at 6 segments per ms released " + to_string(sent));
+            }
+        }
+
+        // without pacing, the whole window goes out at once
+        {
+            TCPConfig cfg;
+            cfg.fixed_isn = WrappingInt32{static_cast<uint32_t>(rd())};
+            cfg.congestion_control = TCPConfig::CongestionControl::NewReno;
+            TCPSender sender = established_sender(cfg, 100, 10000);
+            const auto times = send_times(sender, 100'000);
+            if (times.size() != 10 or times.back() != 0 or sender.pacing_delay_us().has_value()) {
+                throw runtime_error("unpaced sender didn't send its window at once");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.adaptive_rto = true;
+            cfg.rto_min = 10;
+
+            TCPSenderTestHarness test{"RTO follows measured RTTs", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(ExpectSRTT{nullopt});
+            test.execute(ExpectRTO{1000});
+
+            // first sample: SRTT = R, RTTVAR = R/2, RTO = SRTT + 4 * RTTVAR
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            test.execute(ExpectSRTT{20});
+            test.execute(ExpectRTO{60});
+
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_payload_size(3).with_seqno(isn + 1));
+            test.execute(Tick{59});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_payload_size(3).with_seqno(isn + 1));
+            test.execute(ExpectRTO{120});
+
+            // Karn's rule: no sample from the ack of a retransmitted segment, but the backoff is undone
+            test.execute(Tick{50});
+            test.execute(AckReceived{WrappingInt32{isn + 4}});
+            test.execute(ExpectSRTT{20});
+            test.execute(ExpectRTO{60});
+
+            // second sample: RTTVAR = 3/4 * 10 + 1/4 * |20 - 4| = 11.5, SRTT = 7/8 * 20 + 1/8 * 4 = 18
+            test.execute(WriteBytes{"def"});
+            test.execute(ExpectSegment{}.with_payload_size(3).with_seqno(isn + 4));
+            test.execute(Tick{4});
+            test.execute(AckReceived{WrappingInt32{isn + 7}});
+            test.execute(ExpectSRTT{18});
+            test.execute(ExpectRTO{64});
+
+            test.execute(WriteBytes{"ghi"});
+            test.execute(ExpectSegment{}.with_payload_size(3).with_seqno(isn + 7));
+            test.execute(Tick{63});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_payload_size(3).with_seqno(isn + 7));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.adaptive_rto = true;
+
+            TCPSenderTestHarness test{"RTO is at least rto_min", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(Tick{2});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            test.execute(ExpectSRTT{2});
+            test.execute(ExpectRTO{TCPConfig::RTO_MIN_DFLT});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 80;
+            cfg.adaptive_rto = true;
+            cfg.rto_max = 100;
+
+            TCPSenderTestHarness test{"Backoff stops at rto_max", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(Tick{80});
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(ExpectRTO{100});
+            test.execute(Tick{99});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(ExpectRTO{100});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"Without adaptive_rto, RTT is measured but the RTO stays put", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            test.execute(ExpectSRTT{20});
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_payload_size(3).with_seqno(isn + 1));
+            test.execute(Tick{10});
+            test.execute(AckReceived{WrappingInt32{isn + 4}});
+            test.execute(ExpectRTO{1000});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
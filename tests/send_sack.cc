@@ -0,0 +1,123 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            // seqno of the i-th 1000-byte segment
+            auto seg = [&](const uint32_t i) { return WrappingInt32{isn + 1 + 1000 * i}; };
+
+            TCPSenderTestHarness test{"Recovery resends only the holes", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(10000, 'x')});
+            for (uint32_t i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(i)));
+            }
+
+            // segments 0, 2 and 3 are lost
+            test.execute(Tick{5});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(2)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(4), seg(5)}, {seg(1), seg(2)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(4), seg(6)}, {seg(1), seg(2)}}));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(0)));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(2)));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(3)));
+            test.execute(ExpectNoSegment{});
+
+            // each hole is resent once per recovery
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(4), seg(7)}, {seg(1), seg(2)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(2)}.with_win(60000).with_sack({{seg(4), seg(10)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(10)}.with_win(60000));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            auto seg = [&](const uint32_t i) { return WrappingInt32{isn + 1 + 1000 * i}; };
+
+            TCPSenderTestHarness test{"Holes aren't resent until they could have been reordered", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(6000, 'x')});
+            for (uint32_t i = 0; i < 6; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(i)));
+            }
+
+            // segments 0 and 1 arrive last, in the same tick as the others
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(5), seg(6)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(4), seg(6)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(3), seg(6)}}));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(0)));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(2), seg(6)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(6)}.with_win(60000));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            auto seg = [&](const uint32_t i) { return WrappingInt32{isn + 1 + 1000 * i}; };
+
+            TCPSenderTestHarness test{"A lost retransmission is resent a round trip later", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(Tick{40});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(8000, 'x')});
+            for (uint32_t i = 0; i < 8; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(i)));
+            }
+
+            // segment 0 is lost, and so is its first retransmission
+            test.execute(Tick{10});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(2)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(3)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(4)}}));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(0)));
+            test.execute(ExpectNoSegment{});
+
+            // not until a round trip (40 ms) after the retransmission (and the reordering window) has passed
+            test.execute(Tick{40});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(6)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{10});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(7)}}));
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(seg(0)));
+            test.execute(ExpectNoSegment{});
+
+            test.execute(AckReceived{seg(8)}.with_win(60000));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{0});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -15,6 +15,8 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
@@ -99,6 +101,59 @@ struct ExpectBytesInFlight : public SenderExpectation {
     }
 };
 
+struct ExpectRTO : public SenderExpectation {
+    unsigned int _rto;
+
+    ExpectRTO(unsigned int rto) : _rto(rto) {}
+    std::string description() const { return "retransmission timeout of " + std::to_string(_rto) + " ms"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.rto() != _rto) {
+            std::ostringstream ss;
+            ss << "The TCPSender reported a retransmission timeout of " << sender.rto()
+               << " ms, but it was expected to be " << _rto << " ms";
+            throw SenderExpectationViolation(ss.str());
+        }
+    }
+};
+
+struct ExpectSRTT : public SenderExpectation {
+    std::optional<double> _srtt;
+
+    ExpectSRTT(std::optional<double> srtt) : _srtt(srtt) {}
+    std::string description() const {
+        return _srtt.has_value() ? "smoothed RTT of " + std::to_string(_srtt.value()) + " ms" : "no RTT sample";
+    }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.srtt() != _srtt) {
+            std::ostringstream ss;
+            ss << "The TCPSender reported a smoothed RTT of "
+               << (sender.srtt().has_value() ? std::to_string(sender.srtt().value()) : "(none)")
+               << ", but it was expected to be " << (_srtt.has_value() ? std::to_string(_srtt.value()) : "(none)");
+            throw SenderExpectationViolation(ss.str());
+        }
+    }
+};
+
+struct ExpectCwnd : public SenderExpectation {
+    size_t _cwnd;
+
+    ExpectCwnd(size_t cwnd) : _cwnd(cwnd) {}
+    std::string description() const { return "congestion window of " + std::to_string(_cwnd) + " bytes"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        const CongestionController *congestion = sender.congestion_controller();
+        if (congestion == nullptr or congestion->cwnd() != _cwnd) {
+            std::ostringstream ss;
+            ss << "The TCPSender reported a congestion window of "
+               << (congestion ? std::to_string(congestion->cwnd()) : "(none)") << " bytes, but it was expected to be "
+               << _cwnd << " bytes";
+            throw SenderExpectationViolation(ss.str());
+        }
+    }
+};
+
 struct ExpectNoSegment : public SenderExpectation {
     ExpectNoSegment() {}
     std::string description() const { return "no (more) segments"; }
@@ -191,11 +246,15 @@ struct Tick : public SenderAction {
 struct AckReceived : public SenderAction {
     WrappingInt32 _ackno;
     std::optional<uint16_t> _window_advertisement{};
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> _sack_blocks{};
 
     AckReceived(WrappingInt32 ackno) : _ackno(ackno) {}
     std::string description() const {
         std::ostringstream ss;
         ss << "ack " << _ackno.raw_value() << " winsize " << _window_advertisement.value_or(DEFAULT_TEST_WINDOW);
+        for (const auto &[left, right] : _sack_blocks) {
+            ss << " sack " << left << "-" << right;
+        }
         return ss.str();
     }
 
@@ -204,7 +263,15 @@ struct AckReceived : public SenderAction {
         return *this;
     }
 
+    AckReceived &with_sack(std::vector<std::pair<WrappingInt32, WrappingInt32>> blocks) {
+        _sack_blocks = std::move(blocks);
+        return *this;
+    }
+
     void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (not _sack_blocks.empty()) {
+            sender.sack_received(_sack_blocks);
+        }
         sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW));
         sender.fill_window();
     }
@@ -394,7 +461,7 @@ class TCPSenderTestHarness {
   public:
     TCPSenderTestHarness(const std::string &name_, TCPConfig config)
         : outbound_segments()
-        , sender(config.send_capacity, config.rt_timeout, config.fixed_isn)
+        , sender(config)
         , steps_executed()
         , name(name_) {
         sender.fill_window();
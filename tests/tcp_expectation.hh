@@ -549,6 +549,23 @@ struct Tick : public TCPAction {
     void execute(TCPTestHarness &harness) const { harness._fsm.tick(ms_since_last_tick); }
 };
 
+struct Read : public TCPAction {
+    size_t len;
+
+    Read(size_t len_) : len(len_) {}
+
+    std::string description() const {
+        std::ostringstream o;
+        o << "read " << len << " bytes";
+        return o.str();
+    }
+
+    void execute(TCPTestHarness &harness) const {
+        harness._fsm.inbound_stream().pop_output(len);
+        harness._fsm.inbound_stream_read();
+    }
+};
+
 struct Connect : public TCPAction {
     std::string description() const { return "connect"; }
     void execute(TCPTestHarness &harness) const { harness._fsm.connect(); }
@@ -0,0 +1,187 @@
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_header.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//! A 20-byte SYN header followed by `options` (a multiple of four bytes long)
+static string header_with_options(const string &options) {
+    string ret;
+    NetUnparser::u16(ret, 1234);                          // source port
+    NetUnparser::u16(ret, 5678);                          // destination port
+    NetUnparser::u32(ret, 1);                             // seqno
+    NetUnparser::u32(ret, 0);                             // ackno
+    NetUnparser::u8(ret, (5 + options.size() / 4) << 4);  // data offset
+    NetUnparser::u8(ret, 0b0000'0010);                    // SYN
+    NetUnparser::u16(ret, 1000);                          // window
+    NetUnparser::u16(ret, 0);                             // checksum
+    NetUnparser::u16(ret, 0);                             // urgent pointer
+    return ret + options;
+}
+
+//! Parse a serialized segment, filling in a valid checksum first
+static ParseResult parse(string bytes, TCPSegment &seg) {
+    InternetChecksum check;
+    check.add(bytes);
+    const uint16_t cksum = check.value();
+    bytes[16] = static_cast<char>(cksum >> 8);
+    bytes[17] = static_cast<char>(cksum & 0xff);
+    return seg.parse(Buffer{move(bytes)});
+}
+
+int main() {
+    try {
+        // SACK-permitted and SACK blocks survive serialization and parsing
+        {
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().seqno = WrappingInt32{12345};
+            seg.header().sack_permitted = true;
+            seg.header().sack_blocks = {{WrappingInt32{100}, WrappingInt32{200}},
+                                        {WrappingInt32{0xfffffff0}, WrappingInt32{0x10}}};
+            seg.payload() = string("hello");
+
+            TCPSegment parsed;
+            if (parsed.parse(Buffer{seg.serialize().concatenate()}) != ParseResult::NoError) {
+                throw runtime_error("failed to parse a segment with SACK options");
+            }
+            // serialization grows the data offset to fit NOP NOP SACK-permitted, NOP NOP SACK with two blocks
+            if (parsed.header().doff != 5 + 1 + 5) {
+                throw runtime_error("unexpected data offset " + to_string(parsed.header().doff));
+            }
+            seg.header().doff = parsed.header().doff;
+            if (not(parsed.header() == seg.header()) or parsed.payload().str() != "hello") {
+                throw runtime_error("SACK options didn't round-trip: " + parsed.header().summary());
+            }
+        }
+
+        // up to four blocks fit; more don't
+        {
+            TCPHeader header;
+            header.sack_blocks.assign(TCPHeader::MAX_SACK_BLOCKS, {WrappingInt32{1}, WrappingInt32{2}});
+            if (header.serialize().size() != 56) {
+                throw runtime_error("four SACK blocks should make a 56-byte header");
+            }
+            header.sack_blocks.emplace_back(WrappingInt32{3}, WrappingInt32{4});
+            bool threw = false;
+            try {
+                header.serialize();
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            if (not threw) {
+                throw runtime_error("five SACK blocks don't fit in a TCP header");
+            }
+        }
+
+        // unknown options are skipped, and parsing stops at end-of-options
+        {
+            const string options{"\x01"                                      // NOP
+                                 "\x08\x0a\x00\x00\x00\x01\x00\x00\x00\x02"  // timestamps
+                                 "\x04\x02"                                  // SACK-permitted
+                                 "\x00\x05\x0a\x00\x00",                     // EOL, then junk
+                                 18};
+            TCPSegment seg;
+            if (parse(header_with_options(options + string(3, '\0')), seg) != ParseResult::NoError) {
+                throw runtime_error("failed to parse a SYN with unknown options");
+            }
+            if (not seg.header().sack_permitted or not seg.header().sack_blocks.empty()) {
+                throw runtime_error("misparsed options: " + seg.header().summary());
+            }
+        }
+
+        // a SYN as Linux sends it: MSS, SACK-permitted, timestamps, NOP, window scale
+        {
+            const string options{"\x02\x04\x05\xb4"                          // MSS 1460
+                                 "\x04\x02"                                  // SACK-permitted
+                                 "\x08\x0a\x00\x00\x00\x01\x00\x00\x00\x00"  // timestamps
+                                 "\x01\x03\x03\x07",                         // NOP, window scale 7
+                                 20};
+            TCPSegment seg;
+            if (parse(header_with_options(options), seg) != ParseResult::NoError) {
+                throw runtime_error("failed to parse a SYN with window scaling");
+            }
+            if (seg.header().mss != optional<uint16_t>{1460} or seg.header().window_scale != optional<uint8_t>{7} or
+                not seg.header().sack_permitted) {
+                throw runtime_error("misparsed options: " + seg.header().summary());
+            }
+
+            TCPSegment parsed;
+            seg.header().doff = TCPHeader::LENGTH / 4;
+            if (parsed.parse(Buffer{seg.serialize().concatenate()}) != ParseResult::NoError) {
+                throw runtime_error("failed to parse serialized MSS and window scale options");
+            }
+            const TCPHeader &header = parsed.header();
+            if (header.mss != optional<uint16_t>{1460} or header.window_scale != optional<uint8_t>{7} or
+                header.doff != 5 + 1 + 1 + 1) {
+                throw runtime_error("MSS and window scale didn't round-trip: " + header.summary());
+            }
+
+            // parsing a segment without options into the same header leaves none behind
+            if (parse(header_with_options(""), parsed) != ParseResult::NoError or header.mss.has_value() or
+                header.window_scale.has_value() or header.sack_permitted) {
+                throw runtime_error("options outlived a reparse: " + header.summary());
+            }
+        }
+
+        // a segment with options, wrapped in a datagram, has the datagram's length and checksum cover them
+        {
+            TCPOverIPv4Adapter adapter;
+            adapter.config_mut().source = {"10.0.0.1", 1234};
+            adapter.config_mut().destination = {"10.0.0.2", 5678};
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().mss = 1460;
+            seg.header().window_scale = 7;
+            seg.header().sack_permitted = true;
+            seg.payload() = string("hello");
+            if (seg.header().length() != seg.header().serialize().size()) {
+                throw runtime_error("length() disagrees with serialize()");
+            }
+
+            InternetDatagram dgram;
+            if (dgram.parse(adapter.wrap_tcp_in_ip(seg).serialize().concatenate()) != ParseResult::NoError) {
+                throw runtime_error("failed to parse a datagram carrying TCP options");
+            }
+            TCPSegment parsed;
+            if (parsed.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError or
+                parsed.header().mss != optional<uint16_t>{1460} or parsed.payload().str() != "hello") {
+                throw runtime_error("a wrapped segment with options didn't round-trip: " + parsed.header().summary());
+            }
+        }
+
+        // an MSS option must carry two bytes
+        {
+            const string options{"\x02\x03\x05\x01", 4};
+            TCPSegment seg;
+            if (parse(header_with_options(options), seg) == ParseResult::NoError) {
+                throw runtime_error("accepted a short MSS option");
+            }
+        }
+
+        // an option that claims to run past the header is an error
+        {
+            const string options{"\x01\x01\x05\x12\x00\x00\x00\x01\x00\x00\x00\x02", 12};
+            TCPSegment seg;
+            if (parse(header_with_options(options), seg) == ParseResult::NoError) {
+                throw runtime_error("accepted a SACK option longer than the header");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "tcp_sender.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+//! A segment of `size` bytes of varied payload, so that misplaced bytes change the checksum
+static TCPSegment large_segment(const WrappingInt32 seqno, const size_t size) {
+    TCPSegment seg;
+    seg.header().seqno = seqno;
+    seg.header().ack = true;
+    seg.header().ackno = WrappingInt32{4321};
+    seg.header().win = 1234;
+    seg.header().sport = 1111;
+    seg.header().dport = 2222;
+    seg.header().sack_blocks = {{WrappingInt32{5000}, WrappingInt32{6000}}};
+    string payload(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<char>(i * 7 + i / 251);
+    }
+    seg.payload() = move(payload);
+    return seg;
+}
+
+//! Check that `pieces`, parsed, carry `whole` one MSS at a time with the flags where they belong
+static void check_pieces(const TCPSegment &whole, const vector<TCPSegment> &pieces, const string &test) {
+    const size_t expected = (whole.payload().size() + MSS - 1) / MSS;
+    if (pieces.size() != expected) {
+        throw runtime_error(test + ": " + to_string(pieces.size()) + " segments, not " + to_string(expected));
+    }
+    WrappingInt32 seqno = whole.header().seqno;
+    string payload;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        const TCPHeader &header = pieces[i].header();
+        const bool first = i == 0;
+        const bool last = i + 1 == pieces.size();
+        if (header.seqno != seqno or header.ackno != whole.header().ackno or header.win != whole.header().win or
+            header.syn != (whole.header().syn and first) or header.fin != (whole.header().fin and last) or
+            header.psh != (whole.header().psh and last) or header.sack_blocks != whole.header().sack_blocks or
+            pieces[i].payload().size() != (last ? whole.payload().size() - i * MSS : MSS)) {
+            throw runtime_error(test + ": segment " + to_string(i) + " is " + header.summary());
+        }
+        seqno = seqno + pieces[i].length_in_sequence_space();
+        payload += pieces[i].payload().str();
+    }
+    if (payload != whole.payload().str()) {
+        throw runtime_error(test + ": payload changed");
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // a large segment splits into MSS-sized ones with valid checksums; FIN and PSH go on the last
+        {
+            TCPSegment seg = large_segment(WrappingInt32{0xffffff00}, 64000 - 123);
+            seg.header().fin = true;
+            seg.header().psh = true;
+            vector<TCPSegment> pieces;
+            for (const auto &serialized : seg.serialize_segmented(MSS)) {
+                TCPSegment &piece = pieces.emplace_back();
+                if (piece.parse(Buffer{serialized.concatenate()}) != ParseResult::NoError) {
+                    throw runtime_error("test 1 failed: split segment " + to_string(pieces.size()) + " didn't parse");
+                }
+            }
+            check_pieces(seg, pieces, "test 1 failed");
+        }
+
+        // a SYN's options only go on the first
+        {
+            TCPSegment seg = large_segment(WrappingInt32{static_cast<uint32_t>(rd())}, 2500);
+            seg.header().syn = true;
+            seg.header().mss = MSS;
+            seg.header().window_scale = 7;
+            seg.header().sack_permitted = true;
+            seg.header().sack_blocks.clear();
+            vector<TCPSegment> pieces;
+            for (const auto &serialized : seg.serialize_segmented(MSS)) {
+                if (pieces.emplace_back().parse(Buffer{serialized.concatenate()}) != ParseResult::NoError) {
+                    throw runtime_error("test 2 failed: split SYN didn't parse");
+                }
+            }
+            check_pieces(seg, pieces, "test 2 failed");
+            if (not pieces[0].header().mss.has_value() or not pieces[0].header().window_scale.has_value() or
+                not pieces[0].header().sack_permitted or pieces[1].header().mss.has_value() or
+                pieces[1].header().window_scale.has_value() or pieces[1].header().sack_permitted) {
+                throw runtime_error("test 2 failed: SYN options on the wrong segments");
+            }
+        }
+
+        // the IPv4 adapter puts each in its own datagram, checksummed with its own pseudo-header
+        {
+            TCPOverIPv4Adapter adapter;
+            adapter.config_mut().source = {"10.0.0.1", 1111};
+            adapter.config_mut().destination = {"10.0.0.2", 2222};
+            TCPSegment seg = large_segment(WrappingInt32{static_cast<uint32_t>(rd())}, 10 * MSS);
+            seg.offload_mss() = MSS;
+            vector<TCPSegment> pieces;
+            for (const auto &ip_dgram : adapter.wrap_tcp_in_ip_segmented(seg)) {
+                InternetDatagram parsed;
+                if (parsed.parse(Buffer{ip_dgram.serialize().concatenate()}) != ParseResult::NoError) {
+                    throw runtime_error("test 3 failed: datagram didn't parse");
+                }
+                if (pieces.emplace_back().parse(parsed.payload().concatenate(), parsed.header().pseudo_cksum()) !=
+                    ParseResult::NoError) {
+                    throw runtime_error("test 3 failed: segment in datagram didn't parse");
+                }
+            }
+            check_pieces(seg, pieces, "test 3 failed");
+
+            // whatever the sender asked for, datagrams fit in the MTU, options and all
+            seg.offload_mss() = 0;
+            const auto ip_dgrams = adapter.wrap_tcp_in_ip_segmented(seg);
+            if (ip_dgrams.size() != 7) {
+                throw runtime_error("test 3 failed: " + to_string(ip_dgrams.size()) + " datagrams, not 7");
+            }
+            for (const auto &ip_dgram : ip_dgrams) {
+                if (ip_dgram.header().len > TCPOverIPv4Adapter::DEFAULT_MTU) {
+                    throw runtime_error("test 3 failed: datagram of " + to_string(ip_dgram.header().len) + " bytes");
+                }
+            }
+        }
+
+        // a SYN's options, and any segment's SACK blocks, count towards its datagram's length and checksum
+        {
+            TCPOverIPv4Adapter adapter;
+            adapter.config_mut().source = {"10.0.0.1", 1111};
+            adapter.config_mut().destination = {"10.0.0.2", 2222};
+            TCPSegment syn = large_segment(WrappingInt32{static_cast<uint32_t>(rd())}, 2500);
+            syn.header().syn = true;
+            syn.header().window_scale = 7;
+            syn.header().sack_permitted = true;
+            syn.header().sack_blocks.clear();
+            syn.offload_mss() = MSS;
+            TCPSegment small = large_segment(WrappingInt32{static_cast<uint32_t>(rd())}, 100);
+            for (TCPSegment *seg : {&syn, &small}) {
+                vector<TCPSegment> pieces;
+                for (const auto &ip_dgram : adapter.wrap_tcp_in_ip_segmented(*seg)) {
+                    InternetDatagram parsed;
+                    if (parsed.parse(Buffer{ip_dgram.serialize().concatenate()}) != ParseResult::NoError or
+                        pieces.emplace_back().parse(parsed.payload().concatenate(), parsed.header().pseudo_cksum()) !=
+                            ParseResult::NoError) {
+                        throw runtime_error("test 4 failed: " + seg->header().summary() + " didn't parse");
+                    }
+                }
+                check_pieces(*seg, pieces, "test 4 failed");
+            }
+        }
+
+        // with offload, the sender fills the window with large segments, but resends lost data an MSS at a time
+        {
+            TCPConfig cfg;
+            const WrappingInt32 isn{static_cast<uint32_t>(rd())};
+            cfg.fixed_isn = isn;
+            cfg.segmentation_offload = true;
+            cfg.send_capacity = 200000;
+            TCPSender sender{cfg};
+            sender.fill_window();
+            sender.segments_out().pop();
+            sender.ack_received(isn + 1, 100000);
+            sender.stream_in().write(string(100000, 'x'));
+            sender.fill_window();
+
+            vector<size_t> sizes;
+            for (; not sender.segments_out().empty(); sender.segments_out().pop()) {
+                sizes.push_back(sender.segments_out().front().payload().size());
+                if (sender.segments_out().front().offload_mss() != MSS) {
+                    throw runtime_error("test 5 failed: large segment not marked for splitting into MSS pieces");
+                }
+            }
+            if (sizes != vector<size_t>{TCPConfig::MAX_OFFLOAD_SIZE, 100000 - TCPConfig::MAX_OFFLOAD_SIZE}) {
+                throw runtime_error("test 5 failed: sent " + to_string(sizes.size()) + " segments");
+            }
+
+            // the first 2500 bytes arrived; the rest of the first segment was lost
+            sender.ack_received(isn + 2501, 100000);
+            sender.tick(cfg.rt_timeout);
+            if (sender.segments_out().size() != 1 or sender.segments_out().front().payload().size() != MSS or
+                sender.segments_out().front().header().seqno != isn + 2001) {
+                throw runtime_error("test 5 failed: didn't resend just the first unacknowledged MSS");
+            }
+            if (sender.bytes_in_flight() != 100000 - 2500) {
+                throw runtime_error("test 5 failed: " + to_string(sender.bytes_in_flight()) + " bytes in flight");
+            }
+        }
+
+        // a segment as large as the adapter's MSS still fits the MTU once SACK blocks fill the options
+        {
+            TCPOverIPv4Adapter adapter;
+            adapter.config_mut().source = {"10.0.0.1", 1111};
+            adapter.config_mut().destination = {"10.0.0.2", 2222};
+            TCPSegment seg = large_segment(WrappingInt32{static_cast<uint32_t>(rd())}, adapter.mss().value());
+            seg.header().sack_blocks.clear();
+            for (uint32_t i = 0; i < TCPHeader::MAX_SACK_BLOCKS; i++) {
+                seg.header().sack_blocks.emplace_back(WrappingInt32{10000 * i}, WrappingInt32{10000 * i + 500});
+            }
+
+            string payload;
+            for (const auto &ip_dgram : adapter.wrap_tcp_in_ip_segmented(seg)) {
+                if (ip_dgram.header().len > adapter.mtu()) {
+                    throw runtime_error("test 6 failed: datagram of " + to_string(ip_dgram.header().len) + " bytes");
+                }
+                InternetDatagram parsed;
+                TCPSegment piece;
+                if (parsed.parse(Buffer{ip_dgram.serialize().concatenate()}) != ParseResult::NoError or
+                    piece.parse(parsed.payload().concatenate(), parsed.header().pseudo_cksum()) !=
+                        ParseResult::NoError or
+                    piece.header().sack_blocks != seg.header().sack_blocks) {
+                    throw runtime_error("test 6 failed: datagram didn't carry the segment's SACK blocks");
+                }
+                payload += piece.payload().copy();
+            }
+            if (payload != seg.payload().copy()) {
+                throw runtime_error("test 6 failed: the datagrams didn't carry the payload");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "tcp_stack.hh"
+#include "tcp_state.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned int CONNECTIONS = 50;
+static constexpr uint16_t PORT = 80;
+
+//! \returns the datagram, serialized and parsed as a network would
+static InternetDatagram carry(const InternetDatagram &sent) {
+    InternetDatagram ret;
+    test_err_if(ret.parse(sent.serialize().concatenate()) != ParseResult::NoError, "a datagram didn't parse");
+    return ret;
+}
+
+//! Carry the datagrams `from` has queued to `to`, one at a time or all together
+static void deliver(TCPStack &from, TCPStack &to, const bool batch) {
+    vector<InternetDatagram> dgrams;
+    for (auto &out = from.datagrams_out(); not out.empty(); out.pop()) {
+        if (batch) {
+            dgrams.push_back(carry(out.front()));
+        } else {
+            to.datagram_received(carry(out.front()));
+        }
+    }
+    to.datagrams_received(dgrams);
+}
+
+//! What one side of a connection has to send, and what it has received
+struct Stream {
+    string to_send{};
+    size_t written{0};
+    string received{};
+    bool closed{false};
+};
+
+//! Write what's left of a stream to its connection, ending it once it's all written and `done` says so
+static void write_out(TCPStack &stack, const TCPStack::FourTuple &tuple, Stream &stream, const bool done) {
+    stream.written += stack.write(tuple, stream.to_send.substr(stream.written));
+    if (done and stream.written == stream.to_send.size() and not stream.closed) {
+        stack.end_input_stream(tuple);
+        stream.closed = true;
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const Address server_address{"10.0.0.1", PORT};
+        TCPConfig cfg;
+
+        // a SYN for a port no one listens on starts nothing, and isn't answered
+        {
+            TCPStack server;
+            server.listen(PORT, cfg);
+            TCPOverIPv4Adapter adapter;
+            adapter.config_mut().source = {"10.0.0.2", 1000};
+            adapter.config_mut().destination = {"10.0.0.1", PORT + 1};
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{static_cast<uint32_t>(rd())};
+            server.datagram_received(carry(adapter.wrap_tcp_in_ip(syn)));
+            test_err_if(server.size() != 0 or not server.datagrams_out().empty() or server.accept(PORT).has_value(),
+                        "test 1 failed: a SYN for a closed port was answered");
+        }
+
+        // many connections to one listening port each carry their own data, and each goes away once closed,
+        // whether the datagrams arrive one by one or in batches
+        for (const bool batch : {false, true}) {
+            TCPStack server, client;
+            server.listen(PORT, cfg);
+
+            map<uint16_t, Stream> clients;  // by client port
+            map<uint16_t, Stream> servers;  // echoes, by client port
+            vector<TCPStack::FourTuple> tuples;
+            for (unsigned int i = 0; i < CONNECTIONS; i++) {
+                const uint16_t port = 1000 + i;
+                Stream &stream = clients[port];
+                stream.to_send = string(1000 + rd() % 20000, 0);
+                generate(stream.to_send.begin(), stream.to_send.end(), [&] { return rd(); });
+                tuples.push_back(client.connect(cfg, {"10.0.0.2", port}, server_address));
+            }
+            test_err_if(client.size() != CONNECTIONS, "test 2 failed: connections weren't all added");
+
+            vector<TCPStack::FourTuple> accepted;
+            for (unsigned int round = 0; client.size() > 0 or server.size() > 0; round++) {
+                test_err_if(round > 100000, "test 2 failed: connections didn't finish");
+                deliver(client, server, batch);
+                deliver(server, client, batch);
+
+                for (auto tuple = server.accept(PORT); tuple.has_value(); tuple = server.accept(PORT)) {
+                    test_err_if(servers.count(tuple->remote_port), "test 2 failed: connection accepted twice");
+                    servers[tuple->remote_port];
+                    accepted.push_back(tuple.value());
+                }
+
+                // the server echoes what it reads, and closes once the client has
+                for (const auto &tuple : accepted) {
+                    if (not server.contains(tuple)) {
+                        continue;
+                    }
+                    Stream &stream = servers[tuple.remote_port];
+                    const string data = server.read(tuple, 1000000);
+                    stream.received += data;
+                    stream.to_send += data;
+                    if (server.contains(tuple)) {
+                        write_out(server, tuple, stream, server.connection(tuple).inbound_stream().eof());
+                    }
+                }
+                for (const auto &tuple : tuples) {
+                    if (client.contains(tuple)) {
+                        Stream &stream = clients[tuple.local_port];
+                        write_out(client, tuple, stream, true);
+                        stream.received += client.read(tuple, 1000000);
+                    }
+                }
+
+                client.tick(1);
+                server.tick(1);
+            }
+
+            test_err_if(accepted.size() != CONNECTIONS,
+                        "test 2 failed: accepted " + to_string(accepted.size()) + " connections");
+            for (const auto &[port, stream] : clients) {
+                test_err_if(servers[port].received != stream.to_send,
+                            "test 2 failed: server got the wrong data from port " + to_string(port));
+                test_err_if(stream.received != stream.to_send,
+                            "test 2 failed: wrong echo for port " + to_string(port));
+            }
+            test_err_if(client.next_expiry().has_value() or server.next_expiry().has_value(),
+                        "test 2 failed: timers left running");
+        }
+
+        // with delayed ACKs, reading a full window tells the peer at once that the window has reopened
+        {
+            TCPConfig delayed = cfg;
+            delayed.ack_delay = TCPConfig::ACK_DELAY_DFLT;
+            delayed.recv_capacity = 4000;
+            TCPStack server, client;
+            server.listen(PORT, delayed);
+            const auto tuple = client.connect(cfg, {"10.0.0.2", 1000}, server_address);
+            client.write(tuple, string(10000, 'x'));
+
+            optional<TCPStack::FourTuple> accepted;
+            for (unsigned int round = 0; round <= 2 * delayed.ack_delay; round++) {
+                deliver(client, server, false);
+                deliver(server, client, false);
+                accepted = accepted.has_value() ? accepted : server.accept(PORT);
+                client.tick(1);
+                server.tick(1);
+            }
+            test_err_if(not accepted.has_value() or
+                            server.connection(accepted.value()).inbound_stream().buffer_size() != 4000 or
+                            not server.datagrams_out().empty(),
+                        "test 3 failed: the window didn't fill");
+
+            server.read(accepted.value(), 4000);
+            test_err_if(server.datagrams_out().size() != 1, "test 3 failed: no window update");
+            const InternetDatagram update = carry(server.datagrams_out().front());
+            TCPSegment seg;
+            test_err_if(seg.parse(update.payload().concatenate(), update.header().pseudo_cksum()) !=
+                                ParseResult::NoError or
+                            seg.header().win != 4000,
+                        "test 3 failed: window update for " + to_string(seg.header().win) + " bytes");
+        }
+
+        // a port holds at most its backlog of connections until they're accepted, and drops SYNs beyond it,
+        // until a retried SYN finds room
+        {
+            TCPStack server, client;
+            server.listen(PORT, cfg, 2);
+            vector<TCPStack::FourTuple> tuples;
+            for (uint16_t port = 1000; port < 1003; port++) {
+                tuples.push_back(client.connect(cfg, {"10.0.0.2", port}, server_address));
+            }
+            deliver(client, server, false);
+            test_err_if(server.size() != 2, "test 4 failed: " + to_string(server.size()) + " connections started");
+            deliver(server, client, false);
+            test_err_if(client.connection(tuples[2]).state() != TCPState::State::SYN_SENT,
+                        "test 4 failed: a SYN beyond the backlog was answered");
+
+            test_err_if(server.accept(PORT).value().remote_port != 1000, "test 4 failed: first not accepted");
+            client.tick(cfg.rt_timeout);
+            deliver(client, server, false);
+            test_err_if(server.size() != 3, "test 4 failed: the retried SYN was dropped");
+            for (const uint16_t port : {1001, 1002}) {
+                const auto accepted = server.accept(PORT);
+                test_err_if(not accepted.has_value() or accepted->remote_port != port,
+                            "test 4 failed: port " + to_string(port) + " not accepted");
+            }
+            test_err_if(server.accept(PORT).has_value(), "test 4 failed: accepted too many");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return err_num;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "timer_wheel.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! A TCPConnection ticked by a TimerWheel only when it has something to do
+struct WheelDriven {
+    TCPConnection conn;
+    TimerWheel::TimerId timer{0};
+    uint64_t last_tick{0};       //!< wheel time the connection was last ticked
+    vector<uint64_t> sent_at{};  //!< wheel time of each segment it sent
+    size_t ticks{0};
+
+    explicit WheelDriven(const TCPConfig &cfg) : conn{cfg} {}
+};
+
+//! Arm the connection's timer for its next deadline, rounded up to the wheel's milliseconds
+static void rearm(TimerWheel &wheel, WheelDriven &driven) {
+    const auto deadline_us = driven.conn.next_deadline_us();
+    if (deadline_us.has_value()) {
+        wheel.arm(driven.timer, (deadline_us.value() + 999) / 1000);
+    } else {
+        wheel.disarm(driven.timer);
+    }
+}
+
+//! Tick the connection up to the wheel's present, and note what it sent
+static void tick(TimerWheel &wheel, WheelDriven &driven) {
+    driven.conn.tick(wheel.now() - driven.last_tick);
+    driven.last_tick = wheel.now();
+    driven.ticks++;
+    for (; not driven.conn.segments_out().empty(); driven.conn.segments_out().pop()) {
+        driven.sent_at.push_back(wheel.now());
+    }
+    rearm(wheel, driven);
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // timers fire once each, exactly at their deadlines, however far off and however the clock advances
+        {
+            TimerWheel wheel;
+            vector<uint64_t> deadlines;
+            size_t fired = 0;
+            for (unsigned int i = 0; i < 2000; i++) {
+                // spread over every level and beyond the top one
+                deadlines.push_back(uniform_int_distribution<uint64_t>{0, uint64_t{1} << (6 * (i % 6))}(rd));
+                const auto id = wheel.add_timer([&, i] {
+                    fired++;
+                    if (wheel.now() != deadlines[i]) {
+                        throw runtime_error("test 1 failed: timer due at " + to_string(deadlines[i]) + " fired at " +
+                                            to_string(wheel.now()));
+                    }
+                });
+                wheel.arm(id, deadlines[i]);
+            }
+            while (fired < deadlines.size()) {
+                const auto next = wheel.next_expiry();
+                if (not next.has_value()) {
+                    throw runtime_error("test 1 failed: nothing left on the wheel");
+                }
+                wheel.advance(uniform_int_distribution<uint64_t>{0, 3 * next.value()}(rd));
+            }
+            if (wheel.next_expiry().has_value()) {
+                throw runtime_error("test 1 failed: a timer fired twice");
+            }
+        }
+
+        // re-arming moves a timer, disarming or removing it stops it, and a callback may re-arm its own
+        {
+            TimerWheel wheel;
+            vector<uint64_t> fired;
+            const auto moved = wheel.add_timer([&] { fired.push_back(wheel.now()); });
+            const auto stopped = wheel.add_timer([&] { throw runtime_error("test 2 failed: disarmed timer fired"); });
+            const auto removed = wheel.add_timer([&] { throw runtime_error("test 2 failed: removed timer fired"); });
+            TimerWheel::TimerId periodic = 0;
+            periodic = wheel.add_timer([&] {
+                fired.push_back(wheel.now());
+                wheel.arm(periodic, 300);
+            });
+            wheel.arm(moved, 5000);
+            wheel.arm(stopped, 100);
+            wheel.arm(removed, 100);
+            wheel.arm(periodic, 300);
+            wheel.advance(50);
+            wheel.arm(moved, 200);
+            wheel.disarm(stopped);
+            wheel.remove_timer(removed);
+            wheel.advance(1000);
+            if (fired != vector<uint64_t>{250, 300, 600, 900} or not wheel.armed(periodic) or wheel.armed(moved)) {
+                throw runtime_error("test 2 failed: " + to_string(fired.size()) + " timers fired");
+            }
+        }
+
+        // connections ticked only at their deadlines retransmit when ones ticked every millisecond do
+        {
+            TCPConfig cfg;
+            TCPConnection reference{cfg};
+            reference.connect();
+            vector<uint64_t> reference_sent_at;
+            for (uint64_t now = 0;; now++) {
+                for (; not reference.segments_out().empty(); reference.segments_out().pop()) {
+                    reference_sent_at.push_back(now);
+                }
+                if (not reference.active()) {
+                    break;
+                }
+                reference.tick(1);
+            }
+
+            TimerWheel wheel;
+            WheelDriven driven{cfg};
+            driven.timer = wheel.add_timer([&] { tick(wheel, driven); });
+            driven.conn.connect();
+            tick(wheel, driven);
+            driven.ticks = 0;
+            while (wheel.next_expiry().has_value()) {
+                wheel.advance(wheel.next_expiry().value());
+            }
+            if (driven.sent_at != reference_sent_at or driven.conn.active()) {
+                throw runtime_error("test 3 failed: sent " + to_string(driven.sent_at.size()) + " segments, not " +
+                                    to_string(reference_sent_at.size()));
+            }
+            if (driven.ticks != TCPConfig::MAX_RETX_ATTEMPTS + 1) {
+                throw runtime_error("test 3 failed: ticked " + to_string(driven.ticks) + " times");
+            }
+        }
+
+        // with many connections, advancing the wheel ticks only those whose timers expire
+        {
+            constexpr size_t CONNECTIONS = 10000;
+            TCPConfig cfg;
+            TimerWheel wheel;
+            vector<WheelDriven> connections;
+            connections.reserve(CONNECTIONS);
+            for (size_t i = 0; i < CONNECTIONS; i++) {
+                WheelDriven &driven = connections.emplace_back(cfg);
+                driven.timer = wheel.add_timer([&, i] { tick(wheel, connections[i]); });
+                driven.conn.connect();
+                tick(wheel, driven);
+                driven.ticks = 0;
+            }
+
+            size_t ticks = 0;
+            for (unsigned int step = 0; step < 150; step++) {
+                wheel.advance(10);
+            }
+            for (const auto &driven : connections) {
+                ticks += driven.ticks;
+                if (driven.sent_at.size() != 2 or driven.sent_at.back() != cfg.rt_timeout) {
+                    throw runtime_error("test 4 failed: a connection didn't retransmit its SYN on time");
+                }
+            }
+            if (ticks != CONNECTIONS) {
+                throw runtime_error("test 4 failed: " + to_string(ticks) + " ticks in 150 steps of the wheel");
+            }
+
+            // let them give up
+            while (wheel.next_expiry().has_value()) {
+                wheel.advance(wheel.next_expiry().value());
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}